@@ -0,0 +1,43 @@
+#include "analysis.hpp"
+
+Analysis::Analysis() {
+    this->engine.setInfoCallback([this](const SearchResult &result) {
+        this->info.store({ true, this->position, this->player, result });
+    });
+}
+
+// Starts analysing the position, cancelling the previous analysis. The
+// position must not be finished.
+void Analysis::start(const Position &position, Token player, bool rotations) {
+    this->stop();
+
+    this->position = position;
+    this->player = player;
+    this->cancel = false;
+    this->info.store({ true, position, player, {} });
+
+    this->worker = std::thread([this, rotations]() {
+        SearchLimits limits;
+        limits.cancel = &this->cancel;
+
+        SearchResult result = this->engine.search(
+            this->position, this->player, rotations, limits);
+
+        this->info.store({ false, this->position, this->player, result });
+    });
+}
+
+// Cancels the search and waits until the worker notices it
+void Analysis::stop() {
+    if (!this->worker.joinable()) {
+        return;
+    }
+
+    this->cancel = true;
+    this->worker.join();
+}
+
+bool Analysis::analyses(const Position &position, Token player) const {
+    return this->active() && player == this->player &&
+           samePosition(position, this->position);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "search.hpp"
+#include "seqlock.hpp"
+
+// Latest state of the analysis, as seen by the user interface
+struct AnalysisInfo {
+    bool running;
+    Position position;  // Analysed position
+    Token player;
+    SearchResult result;  // Of the deepest finished iteration
+};
+
+// Searches a position on a background thread without any limits, until it
+// is cancelled or the search runs out of depth. Every finished iteration is
+// published through a seqlock, so the user interface can show the progress
+// at any time without waiting for the search.
+class Analysis {
+   private:
+    Engine engine;
+    std::thread worker;
+    std::atomic<bool> cancel{ false };
+    Seqlock<AnalysisInfo> info;
+    Position position;
+    Token player;
+
+   public:
+    Analysis();
+    ~Analysis() { this->stop(); }
+    void start(const Position &position, Token player, bool rotations);
+    void stop();
+    bool active() const { return this->worker.joinable(); }
+    // Whether the analysed position is the given one
+    bool analyses(const Position &position, Token player) const;
+    AnalysisInfo latest() const { return this->info.load(); }
+    void setThreads(unsigned int threads) { this->engine.setThreads(threads); }
+    void setTablebase(const Tablebase *tablebase) {
+        this->engine.setTablebase(tablebase);
+    }
+    void setNetwork(const Network *network) {
+        this->engine.setNetwork(network);
+    }
+};
@@ -0,0 +1,344 @@
+#include "batch.hpp"
+
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "notation.hpp"
+#include "rank.hpp"
+#include "record.hpp"
+
+enum BatchError {
+    BatchNoError = 0,
+    InvalidBoard = 1,    // Text other than cell digits
+    UnknownPlayer = 2,   // No player given and the token counts don't tell
+    GameOver = 3,        // Won, drawn or full position
+    IncompleteBoard = 4,  // Input ended before the last cell
+};
+
+const char *BATCH_ERRORS[] = { "", "invalid board", "unknown player",
+                               "game over", "incomplete board" };
+
+enum SlotState {
+    FreeSlot = 0,
+    ParsedSlot = 1,    // Waiting for a search thread
+    SearchedSlot = 2,  // Waiting for the output
+};
+
+struct BatchSlot {
+    SlotState state = SlotState::FreeSlot;
+    uint64_t origin;  // Line, or game in game records
+    int ply;          // Ply in game records, otherwise -1
+    Position position;
+    Token player;
+    bool rotations;
+    BatchError error;
+    SearchResult result;
+};
+
+// Reads positions from text, one slot at a time
+class TextSource {
+   private:
+    std::ifstream in;
+    uint64_t line = 0;
+    bool rotations;
+
+   public:
+    TextSource(const std::string &path, bool rotations)
+        : in(path), rotations(rotations) {}
+    bool isOpen() const { return this->in.is_open(); }
+
+    // Returns false at the end of the input
+    bool next(BatchSlot *slot) {
+        int cells[CELL_COUNT];
+        unsigned int count = 0;
+        int side = 0;
+        std::string text;
+
+        slot->error = BatchError::BatchNoError;
+        slot->ply = -1;
+        slot->rotations = this->rotations;
+
+        // An invalid position is still read to its last cell, or to the
+        // next blank or comment line, so the following one starts in place.
+        // Invalid characters take the place of a cell, as typos usually do.
+        while (count < CELL_COUNT) {
+            if (!std::getline(this->in, text)) {
+                if (slot->error != BatchError::BatchNoError) {
+                    return true;
+                }
+                // Trailing comments and blank lines aren't a position
+                slot->origin = this->line;
+                slot->error = BatchError::IncompleteBoard;
+                return count > 0;
+            }
+            this->line++;
+
+            if (text.empty() || text[0] == '#') {
+                if (slot->error != BatchError::BatchNoError) {
+                    return true;
+                }
+                continue;
+            }
+
+            for (char c : text) {
+                if (c >= '0' && c <= '2' && count < CELL_COUNT) {
+                    cells[count++] = c - '0';
+                } else if ((c == '1' || c == '2') && side == 0) {
+                    side = c - '0';
+                } else if (!std::isspace((unsigned char)c) && c != ',' &&
+                           c != '{' && c != '}') {
+                    if (slot->error == BatchError::BatchNoError) {
+                        slot->error = BatchError::InvalidBoard;
+                        slot->origin = this->line;
+                    }
+                    count += count < CELL_COUNT;
+                }
+            }
+        }
+
+        if (slot->error != BatchError::BatchNoError) {
+            return true;
+        }
+
+        slot->origin = this->line;
+        slot->position.clear();
+        for (unsigned int cell = 0; cell < CELL_COUNT; cell++) {
+            if (cells[cell] != 0) {
+                slot->position.place(cell, (Token)(cells[cell] - 1));
+            }
+        }
+
+        int difference = bitCount(slot->position.tokens[Token::Player1]) -
+                         bitCount(slot->position.tokens[Token::Player2]);
+        if (side == 0 && (difference == 0 || difference == 1)) {
+            side = difference + 1;
+        }
+
+        if (side == 0) {
+            slot->error = BatchError::UnknownPlayer;
+        }
+        slot->player = (Token)(side - 1);
+
+        return true;
+    }
+};
+
+// Reads the positions before every move of recorded games
+class RecordSource {
+   private:
+    GameRecordReader reader;
+    GameView game;
+    uint64_t game_index = 0;
+    bool started = false;
+    Position position;
+    Token player;
+    const uint8_t *bytes;
+    unsigned int ply = 0;
+    unsigned int played = 0;  // Legal moves of the current game
+
+   public:
+    bool open(const std::string &path) { return this->reader.open(path); }
+
+    // Returns false after the last game
+    bool next(BatchSlot *slot) {
+        while (!this->started || this->ply == this->played) {
+            this->game_index += this->started;
+            this->started = true;
+            if (!this->reader.next(&this->game)) {
+                return false;
+            }
+
+            // Only the moves up to the first illegal one are analysed
+            this->played = replayGame(this->game, &this->position);
+            if (this->played > 0) {
+                unrankPosition(this->game.header.start, &this->position);
+            }
+            this->player = (Token)this->game.header.first;
+            this->bytes = this->game.moves;
+            this->ply = 0;
+        }
+
+        slot->origin = this->game_index;
+        slot->ply = this->ply;
+        slot->position = this->position;
+        slot->player = this->player;
+        slot->rotations = this->game.header.rotations;
+        slot->error = BatchError::BatchNoError;
+
+        Move move;
+        this->bytes += unpackMove(this->bytes, &move);
+        this->position.makeMove(move, this->player);
+        this->player = otherPlayer(this->player);
+        this->ply++;
+
+        return true;
+    }
+};
+
+// Writes the result line of the slot
+void printSlot(const BatchSlot &slot, std::ostream &out) {
+    out << slot.origin;
+    if (slot.ply >= 0) {
+        out << ':' << slot.ply;
+    }
+
+    if (slot.error != BatchError::BatchNoError) {
+        out << " error " << BATCH_ERRORS[slot.error] << '\n';
+        return;
+    }
+
+    char cells[CELL_COUNT + 1] = {};
+    for (unsigned int cell = 0; cell < CELL_COUNT; cell++) {
+        Token token = slot.position.at(cell / BOARD_SIZE, cell % BOARD_SIZE);
+        cells[cell] = token == Token::Empty ? '0' : '1' + token;
+    }
+
+    const SearchResult &result = slot.result;
+    out << " board " << cells << ' ' << slot.player + 1 << " bestmove "
+        << formatMove(result.best_move) << " score " << result.score
+        << " depth " << result.depth << " nodes " << result.nodes << " time "
+        << result.time_ms << '\n';
+}
+
+bool analyzeFile(const std::string &path, const SearchLimits &limits,
+                 bool rotations, unsigned int threads,
+                 const Tablebase *tablebase, const Network *network) {
+    threads = std::max(threads, 1u);
+    auto start = std::chrono::steady_clock::now();
+
+    // Game records are recognised by their header, anything else is text
+    RecordSource records;
+    TextSource text(path, rotations);
+    bool binary = records.open(path);
+    if (!binary && !text.isOpen()) {
+        std::cerr << "Can't read " << path << std::endl;
+        return false;
+    }
+
+    std::vector<BatchSlot> slots(threads * BATCH_SLOTS_PER_THREAD);
+    std::mutex mutex;
+    std::condition_variable changed;
+    // Slots before these indices, counted from the start of the input, are
+    // parsed, claimed by search threads and printed
+    uint64_t parsed = 0, claimed = 0, printed = 0;
+    bool parsing = true;
+
+    std::thread parser([&]() {
+        while (true) {
+            BatchSlot *slot;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock,
+                             [&]() { return parsed < printed + slots.size(); });
+                slot = &slots[parsed % slots.size()];
+            }
+
+            // The free slot isn't touched by other threads
+            if (!(binary ? records.next(slot) : text.next(slot))) {
+                break;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            slot->state = SlotState::ParsedSlot;
+            parsed++;
+            changed.notify_all();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        parsing = false;
+        changed.notify_all();
+    });
+
+    auto search = [&]() {
+        Engine engine;
+        engine.setHashSize(BATCH_HASH_MB);
+        engine.setTablebase(tablebase);
+        engine.setNetwork(network);
+
+        while (true) {
+            BatchSlot *slot;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock,
+                             [&]() { return claimed < parsed || !parsing; });
+                if (claimed == parsed) {
+                    break;
+                }
+                slot = &slots[claimed++ % slots.size()];
+            }
+
+            if (slot->error == BatchError::BatchNoError &&
+                (winners(slot->position) != 0 || slot->position.full())) {
+                slot->error = BatchError::GameOver;
+            }
+            if (slot->error == BatchError::BatchNoError) {
+                slot->result = engine.search(slot->position, slot->player,
+                                             slot->rotations, limits);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            slot->state = SlotState::SearchedSlot;
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> searchers;
+    for (unsigned int i = 0; i < threads; i++) {
+        searchers.emplace_back(search);
+    }
+
+    // Output in input order, waiting for the oldest slot to be searched
+    uint64_t positions = 0, errors = 0, nodes = 0;
+    while (true) {
+        BatchSlot *slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() {
+                return slots[printed % slots.size()].state ==
+                           SlotState::SearchedSlot ||
+                       (!parsing && printed == parsed);
+            });
+            if (printed == parsed) {
+                break;
+            }
+            slot = &slots[printed % slots.size()];
+        }
+
+        printSlot(*slot, std::cout);
+        positions++;
+        errors += slot->error != BatchError::BatchNoError;
+        nodes += slot->error == BatchError::BatchNoError ? slot->result.nodes
+                                                         : 0;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        slot->state = SlotState::FreeSlot;
+        printed++;
+        changed.notify_all();
+    }
+
+    parser.join();
+    for (std::thread &searcher : searchers) {
+        searcher.join();
+    }
+    std::cout.flush();
+
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    std::cerr << std::fixed << std::setprecision(2)
+              << "positions: " << positions << std::endl
+              << "errors: " << errors << std::endl
+              << "nodes: " << nodes << std::endl
+              << "time: " << seconds << " s" << std::endl
+              << "positions/s: " << (seconds > 0 ? positions / seconds : 0)
+              << std::endl;
+
+    return true;
+}
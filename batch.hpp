@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+
+#include "search.hpp"
+
+// Analysis of every position in a file, for labelling large position sets.
+//
+// The input is either a game record file (see record.hpp), whose games are
+// analysed at every position before a move, or text with one position per
+// 36 cell digits: 0 empty, 1 Player 1, 2 Player 2, rows from the top, as in
+// `fillBoard` and the protocol's board command. The cells of a position may
+// span several lines, whitespace, commas and braces between them are
+// ignored and lines starting with '#' are comments. A digit of 1 or 2 after
+// the last cell, on the same line, gives the player to move. Otherwise
+// Player 1 moves when both players have as many tokens, and Player 2 when
+// Player 1 has one more. Other characters make the position invalid. They
+// count as cells, and the position ends after 36 of them or at the next
+// blank or comment line.
+//
+// Parsing, searching and output overlap: one thread parses positions into a
+// fixed ring of slots, the search threads each take the next parsed slot
+// and search it with their own engine, and the calling thread prints the
+// finished slots in input order. Parsing waits while the ring is full, so
+// memory use doesn't depend on the size of the input. Every input position
+// gets one output line:
+//
+//   <origin> board <cells> <player> bestmove <move> score <score>
+//       depth <depth> nodes <nodes> time <ms>
+//   <origin> error <reason>
+//
+// where the origin is the line of the last cell in text input, or of the
+// first invalid character, or
+// <game>:<ply> in game records (from 0).
+
+const unsigned int BATCH_DEFAULT_DEPTH = 4;
+// Searched slots for each search thread, bounding the positions in memory
+const unsigned int BATCH_SLOTS_PER_THREAD = 4;
+// Hash table size of each search thread's engine
+const unsigned int BATCH_HASH_MB = 16;
+
+// Searches every position of the file within the per-position limits, on
+// the given amount of threads, and prints the results to stdout followed
+// by a summary on stderr. `rotations` applies to text input, game records
+// keep the mode of each game. Returns false if the file can't be read.
+bool analyzeFile(const std::string &path, const SearchLimits &limits,
+                 bool rotations, unsigned int threads,
+                 const Tablebase *tablebase, const Network *network);
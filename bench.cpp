@@ -0,0 +1,497 @@
+// Microbenchmarks of the hot paths, printed as JSON so that the results
+// of different builds can be compared by scripts.
+//
+// Every benchmark runs a fixed workload on fixed positions. The workload is
+// repeated until a run takes at least the minimum time, and the median of
+// several runs is reported. Checksums are derived from the benchmarked
+// results, so a change in behaviour shows up next to a change in speed.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "eval.hpp"
+#include "game.hpp"
+#include "movegen.hpp"
+#include "perft.hpp"
+#include "rank.hpp"
+#include "renderer.hpp"
+#include "util.hpp"
+
+const unsigned int BENCH_DEFAULT_REPETITIONS = 5;
+const double BENCH_DEFAULT_MIN_MS = 100;
+// Random positions used by the win check benchmarks
+const unsigned int BENCH_RANDOM_POSITIONS = 256;
+const uint64_t BENCH_SEED = 12345;
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;   // Calls of the workload per run
+    uint64_t operations;   // Operations per call of the workload
+    double ns_per_op;      // Median over the runs
+    double min_ns_per_op;
+    uint64_t checksum;
+};
+
+// Swallows everything written to it
+class NullBuffer : public std::streambuf {
+   protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char *, std::streamsize count) override {
+        return count;
+    }
+};
+
+// Runs the workload, which returns a value for the checksum, often enough
+// to take at least `min_ms`, and times `repetitions` such runs
+BenchResult runBenchmark(const std::string &name, uint64_t operations,
+                         unsigned int repetitions, double min_ms,
+                         const std::function<uint64_t()> &workload) {
+    BenchResult result = { name, 1, operations, 0, 0, 0 };
+    result.checksum = workload();
+
+    // Calibration
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < result.iterations; i++) {
+            workload();
+        }
+        double ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+
+        if (ms >= min_ms) {
+            break;
+        }
+        result.iterations *= 2;
+    }
+
+    std::vector<double> times;
+    for (unsigned int run = 0; run < repetitions; run++) {
+        uint64_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < result.iterations; i++) {
+            checksum += workload();
+        }
+        double ns = std::chrono::duration<double, std::nano>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+
+        times.push_back(ns / (result.iterations * operations));
+
+        // Keeps the results alive
+        if (checksum == 1) {
+            std::cerr << "";
+        }
+    }
+
+    std::sort(times.begin(), times.end());
+    result.ns_per_op = times[times.size() / 2];
+    result.min_ns_per_op = times[0];
+
+    return result;
+}
+
+// Positions reached by random moves, ending at the first win
+std::vector<Position> randomPositions(unsigned int count) {
+    std::vector<Position> positions;
+    Rng rng(BENCH_SEED);
+
+    while (positions.size() < count) {
+        Position position;
+        position.clear();
+        Token player = Token::Player1;
+        unsigned int plies = rng.below(CELL_COUNT - 4);
+
+        for (unsigned int ply = 0; ply < plies; ply++) {
+            Move move = randomMove(position, true, &rng);
+            position.makeMove(move, player);
+            if (winners(position) != 0 || position.full()) {
+                break;
+            }
+            player = otherPlayer(player);
+        }
+
+        positions.push_back(position);
+    }
+
+    return positions;
+}
+
+// Same as `randomPositions`, on any board
+template <class B>
+std::vector<BasicPosition<B>> randomBoardPositions(unsigned int count) {
+    std::vector<BasicPosition<B>> positions;
+    Rng rng(BENCH_SEED);
+
+    while (positions.size() < count) {
+        BasicPosition<B> position;
+        position.clear();
+        Token player = Token::Player1;
+        unsigned int plies = rng.below(B::CELL_COUNT - 4);
+
+        for (unsigned int ply = 0; ply < plies; ply++) {
+            typename B::Bitboard empty = ~position.occupied() & B::BOARD_MASK;
+            for (unsigned int skip = rng.below(bitCount(empty)); skip > 0;
+                 skip--) {
+                empty &= empty - 1;
+            }
+
+            Move move = { (uint8_t)lowestBit(empty),
+                          (uint8_t)rng.below(B::NO_ROTATION + 1) };
+            position.makeMove(move, player);
+            if (winners(position) != 0 || position.full()) {
+                break;
+            }
+            player = otherPlayer(player);
+        }
+
+        positions.push_back(position);
+    }
+
+    return positions;
+}
+
+// Benchmarks of the board code shared by all sizes, named after the size
+template <class B, class Bench>
+void benchBoard(Bench &bench, std::ostream &null_out) {
+    std::string size =
+        "_" + std::to_string(B::SIZE) + "x" + std::to_string(B::SIZE);
+    std::vector<BasicPosition<B>> positions =
+        randomBoardPositions<B>(BENCH_RANDOM_POSITIONS);
+
+    bench("winners" + size, positions.size(), [positions]() {
+        uint64_t sum = 0;
+        for (const BasicPosition<B> &position : positions) {
+            sum += winners(position);
+        }
+        return sum;
+    });
+
+    bench("winners_after_move" + size, positions.size(), [positions]() {
+        uint64_t sum = 0;
+        for (const BasicPosition<B> &position : positions) {
+            BasicPosition<B> child = position;
+            Move move = { (uint8_t)lowestBit(~child.occupied() &
+                                             B::BOARD_MASK),
+                          (uint8_t)(child.key % (B::NO_ROTATION + 1)) };
+            child.makeMove(move, Token::Player1);
+            sum += winnersAfterMove(child, move);
+        }
+        return sum;
+    });
+
+    bench("rotate_quad" + size, B::QUAD_COUNT * 2, [positions]() {
+        BasicPosition<B> position = positions[0];
+        for (unsigned int rot = 0; rot < 2; rot++) {
+            for (unsigned int quad = 0; quad < B::QUAD_COUNT; quad++) {
+                position.rotateQuad(quad, (Rotation)rot);
+            }
+        }
+        return position.key;
+    });
+
+    BasicPosition<B> empty;
+    empty.clear();
+    uint64_t nodes = perft(&empty, Token::Player1, true, 3);
+
+    bench("perft3_empty" + size, nodes, [empty]() {
+        BasicPosition<B> root = empty;
+        return perft(&root, Token::Player1, true, 3);
+    });
+
+    auto renderer = std::make_shared<BasicBoardRenderer<B>>();
+    bench("draw_full" + size, 1, [renderer, positions, &null_out]() {
+        const char symbols[2] = { 'x', 'o' };
+        renderer->invalidate();
+        renderer->render(null_out, "Benchmark", positions[1], symbols, "");
+        return (uint64_t)1;
+    });
+}
+
+void printJson(const std::vector<BenchResult> &results) {
+    std::cout << "{" << std::endl
+              << "  \"board_size\": " << BOARD_SIZE << "," << std::endl
+#ifdef NDEBUG
+              << "  \"build\": \"release\"," << std::endl
+#else
+              << "  \"build\": \"debug\"," << std::endl
+#endif
+              << "  \"compiler\": \"" << __VERSION__ << "\"," << std::endl
+              << "  \"benchmarks\": [" << std::endl;
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &result = results[i];
+        std::cout << "    {\"name\": \"" << result.name
+                  << "\", \"iterations\": " << result.iterations
+                  << ", \"operations\": " << result.operations
+                  << ", \"ns_per_op\": " << result.ns_per_op
+                  << ", \"min_ns_per_op\": " << result.min_ns_per_op
+                  << ", \"ops_per_s\": "
+                  << (uint64_t)(result.ns_per_op > 0 ? 1e9 / result.ns_per_op
+                                                     : 0)
+                  << ", \"checksum\": " << result.checksum << "}"
+                  << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+
+    std::cout << "  ]" << std::endl << "}" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int repetitions = BENCH_DEFAULT_REPETITIONS;
+    double min_ms = BENCH_DEFAULT_MIN_MS;
+    std::string filter;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if (std::strcmp(argv[i], "--filter") == 0 && has_value) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && has_value) {
+            repetitions = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && has_value) {
+            min_ms = std::atof(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [options]" << std::endl
+                      << "\t--filter TEXT        run only benchmarks with "
+                         "TEXT in their name"
+                      << std::endl
+                      << "\t--repetitions N      timed runs of each "
+                         "benchmark, the median is reported"
+                      << std::endl
+                      << "\t--min-time MS        minimum duration of a run"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    auto bench = [&](const std::string &name, uint64_t operations,
+                     const std::function<uint64_t()> &workload) {
+        if (name.find(filter) != std::string::npos) {
+            results.push_back(runBenchmark(name, operations, repetitions,
+                                           min_ms, workload));
+        }
+    };
+
+    std::vector<Position> positions = randomPositions(BENCH_RANDOM_POSITIONS);
+    std::vector<BenchmarkPosition> fixed = benchmarkPositions();
+
+    bench("winners", positions.size(), [&]() {
+        uint64_t sum = 0;
+        for (const Position &position : positions) {
+            sum += winners(position);
+        }
+        return sum;
+    });
+
+    bench("winners_after_move", positions.size(), [&]() {
+        uint64_t sum = 0;
+        for (const Position &position : positions) {
+            Position child = position;
+            Move move = { (uint8_t)__builtin_ctzll(~child.occupied() &
+                                                   BOARD_MASK),
+                          (uint8_t)(child.key % (NO_ROTATION + 1)) };
+            child.makeMove(move, Token::Player1);
+            sum += winnersAfterMove(child, move);
+        }
+        return sum;
+    });
+
+    // Both players' points of view
+    std::vector<Token> players;
+    for (size_t i = 0; i < positions.size(); i++) {
+        players.push_back((Token)(i % 2));
+    }
+
+    bench("evaluate", positions.size(), [&]() {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < positions.size(); i++) {
+            sum += evaluate(positions[i], players[i]);
+        }
+        return sum;
+    });
+
+    // The checksums match `evaluate` when the paths give the same scores
+    std::vector<int> scores(positions.size());
+    for (EvalPath path : { EvalPath::ScalarEval, EvalPath::Avx2Eval }) {
+        if (!evalPathSupported(path)) {
+            continue;
+        }
+
+        bench(std::string("evaluate_batch_") +
+                  (path == EvalPath::Avx2Eval ? "avx2" : "scalar"),
+              positions.size(), [&, path]() {
+                  evaluateBatch(positions.data(), players.data(),
+                                positions.size(), scores.data(), path);
+                  uint64_t sum = 0;
+                  for (int score : scores) {
+                      sum += score;
+                  }
+                  return sum;
+              });
+    }
+
+    std::vector<uint64_t> ranks;
+    std::vector<uint64_t> slice_indices;
+    for (const Position &position : positions) {
+        ranks.push_back(rankPosition(position));
+        slice_indices.push_back(rankInSlice(position));
+    }
+
+    bench("rank_position", positions.size(), [&]() {
+        uint64_t sum = 0;
+        for (const Position &position : positions) {
+            sum += rankPosition(position);
+        }
+        return sum;
+    });
+
+    bench("unrank_position", ranks.size(), [&]() {
+        uint64_t sum = 0;
+        for (uint64_t rank : ranks) {
+            Position position;
+            unrankPosition(rank, &position);
+            sum += position.key;
+        }
+        return sum;
+    });
+
+    bench("rank_in_slice", positions.size(), [&]() {
+        uint64_t sum = 0;
+        for (const Position &position : positions) {
+            sum += rankInSlice(position);
+        }
+        return sum;
+    });
+
+    bench("unrank_in_slice", positions.size(), [&]() {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < positions.size(); i++) {
+            Position position;
+            unrankInSlice(__builtin_popcountll(positions[i].tokens[Player1]),
+                          __builtin_popcountll(positions[i].tokens[Player2]),
+                          slice_indices[i], &position);
+            sum += position.key;
+        }
+        return sum;
+    });
+
+    // Game is a large object, only one of them is needed
+    Game game("Benchmark");
+
+    // A move followed by the incremental check and its undo
+    bench("check_win_condition", 1, [&]() {
+        game.playMove({ 14, rotationCode(0, Rotation::Clockwise) });
+        game.checkWinCondition();
+        game.undoMove();
+        return (uint64_t)game.tokenAt(0, 0);
+    });
+
+    bench("check_win_condition_full", 1, [&]() {
+        game.fillBoard(EXAMPLE_BOARD);
+        game.checkWinCondition();
+        return (uint64_t)game.getPosition().key;
+    });
+
+    game.loadExampleBoard();
+
+    bench("rotate_quad_right", QUAD_COUNT * 2, [&]() {
+        for (unsigned int i = 0; i < 2; i++) {
+            for (unsigned int quad = 0; quad < QUAD_COUNT; quad++) {
+                unsigned int origin = quadOrigin(quad);
+                game.rotateQuadRight(origin / BOARD_SIZE,
+                                     origin % BOARD_SIZE);
+            }
+        }
+        return game.getPosition().key;
+    });
+
+    bench("rotate_quad_left", QUAD_COUNT * 2, [&]() {
+        for (unsigned int i = 0; i < 2; i++) {
+            for (unsigned int quad = 0; quad < QUAD_COUNT; quad++) {
+                unsigned int origin = quadOrigin(quad);
+                game.rotateQuadLeft(origin / BOARD_SIZE, origin % BOARD_SIZE);
+            }
+        }
+        return game.getPosition().key;
+    });
+
+    // Fills the board and clears it again
+    bench("place_token", CELL_COUNT, [&]() {
+        for (unsigned int y = 0; y < BOARD_SIZE; y++) {
+            for (unsigned int x = 0; x < BOARD_SIZE; x++) {
+                game.placeToken(y, x, (Token)((x + y) % 2));
+            }
+        }
+        uint64_t key = game.getPosition().key;
+        game.clearBoard();
+        return key;
+    });
+
+    for (const BenchmarkPosition &position : fixed) {
+        bench(std::string("generate_moves_") + position.name, 1, [&]() {
+            MoveList list;
+            generateMoves(position.position, position.player, true, &list);
+            return (uint64_t)list.count;
+        });
+    }
+
+    for (const BenchmarkPosition &position : fixed) {
+        bench(std::string("generate_root_moves_") + position.name, 1, [&]() {
+            MoveList list;
+            generateRootMoves(position.position, position.player, true,
+                              &list);
+            return (uint64_t)list.count;
+        });
+    }
+
+    // Reports nodes per second of the move tree walk
+    for (const BenchmarkPosition &position : fixed) {
+        Position root = position.position;
+        uint64_t nodes = perft(&root, position.player, true, 3);
+
+        bench(std::string("perft3_") + position.name, nodes, [&]() {
+            Position root = position.position;
+            return perft(&root, position.player, true, 3);
+        });
+    }
+
+    game.loadExampleBoard();
+    NullBuffer null_buffer;
+    std::streambuf *output = std::cout.rdbuf(&null_buffer);
+
+    // Frames which change the cells of a quad
+    bench("draw", 1, [&]() {
+        game.rotateQuadRight(0, 0);
+        game.draw();
+        return game.getPosition().key;
+    });
+
+    BoardRenderer renderer;
+    const char symbols[2] = { 'x', 'o' };
+    bench("draw_full", 1, [&]() {
+        renderer.invalidate();
+        renderer.render(std::cout, "Benchmark", game.getPosition(), symbols,
+                        "");
+        return (uint64_t)1;
+    });
+
+    std::cout.rdbuf(output);
+
+    std::ostream null_out(&null_buffer);
+    benchBoard<Board6>(bench, null_out);
+    benchBoard<Board8>(bench, null_out);
+    benchBoard<Board9>(bench, null_out);
+
+    printJson(results);
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "benchmark.hpp"
+
+#include <iomanip>
+#include <iostream>
+
+#include "game.hpp"
+#include "search.hpp"
+
+// A balanced position after 10 moves, Player 1 to move
+const int MIDGAME_BOARD[BOARD_SIZE][BOARD_SIZE] = {
+    { 1, 0, 0, 0, 2, 0 }, { 0, 2, 1, 0, 0, 0 }, { 0, 0, 1, 2, 0, 0 },
+    { 0, 0, 2, 1, 0, 0 }, { 0, 1, 0, 0, 2, 0 }, { 0, 0, 0, 0, 0, 0 },
+};
+
+// A position with 8 empty cells and no win yet, Player 1 to move. Small
+// enough to be solved completely by the tablebase builder.
+const int ENDGAME_BOARD[BOARD_SIZE][BOARD_SIZE] = {
+    { 1, 1, 2, 2, 2, 0 }, { 1, 0, 2, 0, 1, 0 }, { 1, 1, 1, 2, 1, 1 },
+    { 2, 1, 0, 2, 2, 2 }, { 1, 2, 0, 2, 1, 0 }, { 1, 2, 2, 0, 2, 1 },
+};
+
+std::vector<BenchmarkPosition> benchmarkPositions() {
+    std::vector<BenchmarkPosition> positions(4);
+
+    positions[0].name = "empty";
+    positions[0].position.clear();
+    positions[0].player = Token::Player1;
+
+    positions[1].name = "midgame";
+    positions[1].position.clear();
+    fillPosition(&positions[1].position, MIDGAME_BOARD);
+    positions[1].player = Token::Player1;
+
+    positions[2].name = "example";
+    positions[2].position.clear();
+    fillPosition(&positions[2].position, EXAMPLE_BOARD);
+    positions[2].player = Token::Player2;
+
+    positions[3].name = "endgame";
+    positions[3].position.clear();
+    fillPosition(&positions[3].position, ENDGAME_BOARD);
+    positions[3].player = Token::Player1;
+
+    return positions;
+}
+
+// Searches every benchmark position to a fixed depth with 1 to `max_threads`
+// threads, starting from an empty transposition table each time, and prints
+// the time to reach the depth and the node rate
+void runThreadBenchmark(unsigned int max_threads, unsigned int depth) {
+    std::vector<BenchmarkPosition> positions = benchmarkPositions();
+    Engine engine;
+    SearchLimits limits;
+    limits.depth = depth;
+
+    double base_ms = 0;
+    double base_nps = 0;
+
+    std::cout << std::fixed << std::setprecision(2) << "Pentago, depth "
+              << depth << std::endl
+              << "threads   time ms        nodes    nodes/s  time-to-depth "
+                 "speedup  nps speedup"
+              << std::endl;
+
+    for (unsigned int threads = 1; threads <= max_threads; threads++) {
+        engine.setThreads(threads);
+        double total_ms = 0;
+        uint64_t total_nodes = 0;
+
+        for (const BenchmarkPosition &bench : positions) {
+            engine.clear();
+            auto start = std::chrono::steady_clock::now();
+            SearchResult result =
+                engine.search(bench.position, bench.player, true, limits);
+            total_ms += std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+            total_nodes += result.nodes;
+        }
+
+        double nps = total_ms > 0 ? total_nodes / (total_ms / 1000) : 0;
+        if (threads == 1) {
+            base_ms = total_ms;
+            base_nps = nps;
+        }
+
+        std::cout << std::setw(7) << threads << std::setw(10) << total_ms
+                  << std::setw(13) << total_nodes << std::setw(11)
+                  << (uint64_t)nps << std::setw(23) << base_ms / total_ms
+                  << std::setw(13) << (base_nps > 0 ? nps / base_nps : 0)
+                  << std::endl;
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+
+#include "position.hpp"
+
+// Fixed positions used by the benchmarks
+struct BenchmarkPosition {
+    const char *name;
+    Position position;
+    Token player;
+};
+
+std::vector<BenchmarkPosition> benchmarkPositions();
+void runThreadBenchmark(unsigned int max_threads, unsigned int depth);
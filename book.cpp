@@ -0,0 +1,216 @@
+#include "book.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "search.hpp"
+#include "symmetry.hpp"
+
+// Hash table size of each builder thread's engine
+const unsigned int BOOK_HASH_MB = 16;
+
+uint64_t bookKey(const Position &position, Token player, bool rotations,
+                 unsigned int *symmetry) {
+    // Player 2 to move is looked up with the colours swapped
+    if (player == Token::Player2) {
+        Position swapped;
+        swapped.clear();
+        for (unsigned int p = Token::Player1; p <= Token::Player2; p++) {
+            for (Bitboard tokens = position.tokens[p]; tokens != 0;
+                 tokens &= tokens - 1) {
+                swapped.place(lowestBit(tokens), otherPlayer((Token)p));
+            }
+        }
+        return bookKey(swapped, Token::Player1, rotations, symmetry);
+    }
+
+    uint64_t key = canonicalKey(position, symmetry);
+    if (!rotations) {
+        key ^= ZOBRIST.no_rotations;
+    }
+
+    return key;
+}
+
+struct BookPosition {
+    Position position;
+    Token player;
+};
+
+bool buildBook(const std::string &path, unsigned int plies,
+               unsigned int depth, bool rotations, unsigned int threads) {
+    threads = std::max(threads, 1u);
+    auto start = std::chrono::steady_clock::now();
+
+    // One variant of every position, ply by ply
+    std::vector<BookPosition> positions;
+    std::vector<BookPosition> frontier(1);
+    std::unordered_set<uint64_t> seen;
+    frontier[0].position.clear();
+    frontier[0].player = Token::Player1;
+
+    for (unsigned int ply = 0; ply < plies && !frontier.empty(); ply++) {
+        std::vector<BookPosition> next;
+
+        for (const BookPosition &entry : frontier) {
+            positions.push_back(entry);
+            if (ply + 1 == plies) {
+                continue;
+            }
+
+            // Symmetric moves are left out already
+            MoveList list;
+            generateRootMoves(entry.position, entry.player, rotations, &list);
+
+            for (unsigned int i = 0; i < list.count; i++) {
+                BookPosition child = { entry.position,
+                                       otherPlayer(entry.player) };
+                child.position.makeMove(list.moves[i], entry.player);
+                if (winnersAfterMove(child.position, list.moves[i]) != 0 ||
+                    child.position.full()) {
+                    continue;
+                }
+
+                unsigned int symmetry;
+                if (seen.insert(bookKey(child.position, child.player,
+                                        rotations, &symmetry))
+                        .second) {
+                    next.push_back(child);
+                }
+            }
+        }
+
+        std::cout << "ply " << ply << ": " << frontier.size() << " positions"
+                  << std::endl;
+        frontier = std::move(next);
+    }
+
+    std::vector<BookEntry> entries(positions.size());
+    std::atomic<size_t> next(0);
+
+    auto work = [&]() {
+        Engine engine;
+        engine.setHashSize(BOOK_HASH_MB);
+        SearchLimits limits;
+        limits.depth = depth;
+
+        for (size_t index = next++; index < positions.size();
+             index = next++) {
+            const BookPosition &entry = positions[index];
+            SearchResult result = engine.search(entry.position, entry.player,
+                                                rotations, limits);
+
+            unsigned int symmetry;
+            BookEntry &out = entries[index];
+            out.key =
+                bookKey(entry.position, entry.player, rotations, &symmetry);
+            Move move = transformMove(result.best_move, symmetry);
+            out.score = result.score;
+            out.cell = move.cell;
+            out.rotation = move.rotation;
+            out.depth = result.depth;
+        }
+    };
+
+    std::vector<std::thread> helpers;
+    for (unsigned int i = 1; i < threads; i++) {
+        helpers.emplace_back(work);
+    }
+
+    work();
+
+    for (std::thread &helper : helpers) {
+        helper.join();
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const BookEntry &a, const BookEntry &b) {
+                  return a.key < b.key;
+              });
+
+    BookHeader header = {};
+    std::memcpy(header.magic, BOOK_MAGIC, sizeof(header.magic));
+    header.version = BOOK_VERSION;
+    header.plies = plies;
+    header.depth = depth;
+    header.rotations = rotations;
+    header.count = entries.size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write((const char *)&header, sizeof(header));
+    out.write((const char *)entries.data(),
+              entries.size() * sizeof(BookEntry));
+
+    if (!out) {
+        std::cout << "Can't write " << path << std::endl;
+        return false;
+    }
+
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    std::cout << std::fixed << std::setprecision(3)
+              << "positions: " << entries.size() << std::endl
+              << "time: " << seconds << " s" << std::endl;
+
+    return true;
+}
+
+bool OpeningBook::open(const std::string &path) {
+    this->header = nullptr;
+    this->entries = nullptr;
+
+    if (!this->file.open(path)) {
+        return false;
+    }
+
+    const BookHeader *header = (const BookHeader *)this->file.data();
+    if (this->file.size() < sizeof(BookHeader) ||
+        std::memcmp(header->magic, BOOK_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != BOOK_VERSION ||
+        this->file.size() !=
+            sizeof(BookHeader) + header->count * sizeof(BookEntry)) {
+        this->file.close();
+        return false;
+    }
+
+    this->header = header;
+    this->entries = (const BookEntry *)(header + 1);
+
+    return true;
+}
+
+bool OpeningBook::probe(const Position &position, Token player,
+                        bool rotations, Move *move, int *score,
+                        unsigned int *depth) const {
+    if (this->header == nullptr ||
+        (bool)this->header->rotations != rotations) {
+        return false;
+    }
+
+    unsigned int symmetry;
+    uint64_t key = bookKey(position, player, rotations, &symmetry);
+    const BookEntry *end = this->entries + this->header->count;
+    const BookEntry *found = std::lower_bound(
+        this->entries, end, key,
+        [](const BookEntry &entry, uint64_t key) { return entry.key < key; });
+
+    if (found == end || found->key != key) {
+        return false;
+    }
+
+    *move = transformMove({ found->cell, found->rotation },
+                          inverseSymmetry(symmetry));
+    *score = found->score;
+    *depth = found->depth;
+
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "mapped_file.hpp"
+#include "position.hpp"
+
+// Opening book: the searched best move of every position in the first plies
+// of a game, built offline.
+//
+// The rules don't depend on the colours, so positions with Player 2 to move
+// are stored as the position with the colours swapped and Player 1 to move,
+// and entries serve games started by either player. Positions are stored
+// once for all their symmetric variants, under the canonical key of this
+// Player 1 position, and with the move transformed into the canonical
+// variant. The file holds a header followed by fixed-size records sorted
+// by key, so lookups are a binary search directly in the memory-mapped
+// file.
+
+const char BOOK_MAGIC[8] = { 'P', 'T', 'G', 'O', 'B', 'O', 'O', 'K' };
+const uint32_t BOOK_VERSION = 2;
+const unsigned int BOOK_DEFAULT_PLIES = 3;
+const unsigned int BOOK_DEFAULT_DEPTH = 3;
+
+struct BookHeader {
+    char magic[8];
+    uint32_t version;
+    uint8_t plies;      // Positions after fewer plies than this are stored
+    uint8_t depth;      // Search depth of every position
+    uint8_t rotations;  // Whether moves rotate quads
+    uint8_t reserved;
+    uint64_t count;     // Records following the header
+};
+
+static_assert(sizeof(BookHeader) == 24);
+
+struct BookEntry {
+    uint64_t key;
+    int32_t score;
+    uint8_t cell;
+    uint8_t rotation;
+    uint8_t depth;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(BookEntry) == 16);
+
+// Key of the position in the book, shared by its symmetric variants and by
+// the position with swapped colours and the other player to move.
+// `symmetry` receives the symmetry mapping moves into the stored variant.
+uint64_t bookKey(const Position &position, Token player, bool rotations,
+                 unsigned int *symmetry);
+
+// Searches every position reachable in fewer than `plies` plies from the
+// empty board to the given depth and writes the book file. Positions are
+// split between the threads, each running its own single-threaded engine.
+// Prints the progress and returns false if the file couldn't be written.
+bool buildBook(const std::string &path, unsigned int plies,
+               unsigned int depth, bool rotations, unsigned int threads);
+
+class OpeningBook {
+   private:
+    MappedFile file;
+    const BookHeader *header = nullptr;
+    const BookEntry *entries = nullptr;
+
+   public:
+    // Returns false if the file can't be mapped or isn't a book
+    bool open(const std::string &path);
+    // Looks up the position, returning false when it isn't in the book.
+    // The move is transformed back to the position's orientation.
+    bool probe(const Position &position, Token player, bool rotations,
+               Move *move, int *score, unsigned int *depth) const;
+    uint64_t size() const { return this->header ? this->header->count : 0; }
+};
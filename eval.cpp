@@ -0,0 +1,355 @@
+#include "eval.hpp"
+
+// Score of an open line (one without opponent tokens) by its token count
+constexpr int lineWeight(unsigned int tokens) {
+    return tokens == 0 ? 0 : 1 << (2 * (tokens - 1));
+}
+
+// Extra score for a line one token short of winning
+const int THREAT_WEIGHT = 64;
+// Score for every quad where a player has more tokens than the opponent
+const int QUAD_WEIGHT = 2;
+// Score for every token on a quad center, which no rotation can move
+const int CENTER_WEIGHT = 3;
+
+constexpr Bitboard makeCenterMask() {
+    Bitboard mask = 0;
+
+    if (QUAD_SIZE % 2 == 1) {
+        for (unsigned int quad = 0; quad < QUAD_COUNT; quad++) {
+            mask |= (Bitboard)1
+                    << (quadOrigin(quad) +
+                        cellIndex(QUAD_SIZE / 2, QUAD_SIZE / 2));
+        }
+    }
+
+    return mask;
+}
+
+const Bitboard CENTER_MASK = makeCenterMask();
+
+int evaluate(const Position &position, Token player) {
+    Bitboard own = position.tokens[player];
+    Bitboard other = position.tokens[otherPlayer(player)];
+    int score = 0;
+
+    for (unsigned int i = 0; i < WIN_LINE_COUNT; i++) {
+        Bitboard mask = WIN_LINES.masks[i];
+        unsigned int own_count = __builtin_popcountll(own & mask);
+        unsigned int other_count = __builtin_popcountll(other & mask);
+
+        if (other_count == 0) {
+            score += lineWeight(own_count);
+            score += own_count == WIN_LENGTH - 1 ? THREAT_WEIGHT : 0;
+        } else if (own_count == 0) {
+            score -= lineWeight(other_count);
+            score -= other_count == WIN_LENGTH - 1 ? THREAT_WEIGHT : 0;
+        }
+    }
+
+    for (unsigned int quad = 0; quad < QUAD_COUNT; quad++) {
+        int own_count = __builtin_popcountll(own & QUAD_MASKS[quad]);
+        int other_count = __builtin_popcountll(other & QUAD_MASKS[quad]);
+
+        if (own_count > other_count) {
+            score += QUAD_WEIGHT;
+        } else if (own_count < other_count) {
+            score -= QUAD_WEIGHT;
+        }
+    }
+
+    score += CENTER_WEIGHT * __builtin_popcountll(own & CENTER_MASK);
+    score -= CENTER_WEIGHT * __builtin_popcountll(other & CENTER_MASK);
+
+    return score;
+}
+
+// Distance between the cells of the win lines in each direction
+constexpr unsigned int LINE_STEPS[4] = { 1, BOARD_SIZE, BOARD_SIZE + 1,
+                                     BOARD_SIZE - 1 };
+// Moves the first cells of the lines of each direction to bits unused by
+// the other directions, so that all lines fit into one bitboard
+constexpr unsigned int LINE_PACK_SHIFTS[4] = { 0, 40, 2, 0 };
+
+// First cells of the win lines, by direction and packed together
+struct LineStarts {
+    Bitboard masks[4];
+    Bitboard packed;
+};
+
+constexpr LineStarts makeLineStarts() {
+    LineStarts starts = {};
+
+    for (unsigned int i = 0; i < WIN_LINE_COUNT; i++) {
+        Bitboard mask = WIN_LINES.masks[i];
+        unsigned int first = lowestBit(mask);
+        unsigned int step = lowestBit(mask & (mask - 1)) - first;
+
+        for (unsigned int dir = 0; dir < 4; dir++) {
+            if (LINE_STEPS[dir] == step) {
+                starts.masks[dir] |= (Bitboard)1 << first;
+                starts.packed |= (Bitboard)1 << (first + LINE_PACK_SHIFTS[dir]);
+            }
+        }
+    }
+
+    return starts;
+}
+
+constexpr LineStarts LINE_STARTS = makeLineStarts();
+
+// Every line keeps its own bit, and three bits hold its token count
+static_assert(bitCount(LINE_STARTS.packed) == WIN_LINE_COUNT);
+static_assert(WIN_LENGTH == 5 && BOARD_SIZE == 6);
+
+// Score of an open line, including the threat bonus
+constexpr int openLineScore(unsigned int tokens) {
+    return lineWeight(tokens) + (tokens == WIN_LENGTH - 1 ? THREAT_WEIGHT : 0);
+}
+
+// Token counts of all win lines, bit-sliced: bit b of the count of a line
+// is set in counts[b], at the line's bit in the packed bitboard
+void countLines(Bitboard tokens, Bitboard counts[3]) {
+    counts[0] = counts[1] = counts[2] = 0;
+
+    for (unsigned int dir = 0; dir < 4; dir++) {
+        unsigned int step = LINE_STEPS[dir];
+        Bitboard a = tokens, b = tokens >> step, c = tokens >> (2 * step);
+        Bitboard d = tokens >> (3 * step), e = tokens >> (4 * step);
+
+        // Two full adders: a + b + c = s1 + 2 k1, s1 + d + e = s2 + 2 k2
+        Bitboard ab = a ^ b, s1 = ab ^ c, k1 = (a & b) | (ab & c);
+        Bitboard s1d = s1 ^ d, s2 = s1d ^ e, k2 = (s1 & d) | (s1d & e);
+
+        Bitboard starts = LINE_STARTS.masks[dir];
+        unsigned int shift = LINE_PACK_SHIFTS[dir];
+        counts[0] |= (s2 & starts) << shift;
+        counts[1] |= ((k1 ^ k2) & starts) << shift;
+        counts[2] |= ((k1 & k2) & starts) << shift;
+    }
+}
+
+// Sum of the scores of the player's open lines
+int openLinesScore(const Bitboard own[3], const Bitboard other[3]) {
+    Bitboard open = LINE_STARTS.packed & ~(other[0] | other[1] | other[2]);
+
+    // Counts above 5 can't happen, so fewer bits tell them apart
+    return openLineScore(1) * bitCount(open & own[0] & ~(own[1] | own[2])) +
+           openLineScore(2) * bitCount(open & own[1] & ~own[0]) +
+           openLineScore(3) * bitCount(open & own[1] & own[0]) +
+           openLineScore(4) * bitCount(open & own[2] & ~own[0]) +
+           openLineScore(5) * bitCount(open & own[2] & own[0]);
+}
+
+int evaluateSliced(Bitboard own, Bitboard other) {
+    Bitboard own_counts[3], other_counts[3];
+    countLines(own, own_counts);
+    countLines(other, other_counts);
+
+    int score = openLinesScore(own_counts, other_counts) -
+                openLinesScore(other_counts, own_counts);
+
+    for (unsigned int quad = 0; quad < QUAD_COUNT; quad++) {
+        int own_count = bitCount(own & QUAD_MASKS[quad]);
+        int other_count = bitCount(other & QUAD_MASKS[quad]);
+        score += QUAD_WEIGHT * ((own_count > other_count) -
+                                (own_count < other_count));
+    }
+
+    score += CENTER_WEIGHT * ((int)bitCount(own & CENTER_MASK) -
+                              (int)bitCount(other & CENTER_MASK));
+
+    return score;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define EVAL_AVX2 __attribute__((target("avx2")))
+
+// Set bits of each 64-bit lane, counted by nibble lookups
+EVAL_AVX2 inline __m256i popcount256(__m256i bits) {
+    const __m256i lookup =
+        _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1,
+                         1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibbles = _mm256_set1_epi8(0x0f);
+    __m256i low = _mm256_and_si256(bits, nibbles);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(bits, 4), nibbles);
+    __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low),
+                                     _mm256_shuffle_epi8(lookup, high));
+    return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+}
+
+// Multiplies lanes by the weight. The multiply only reads the low 32 bits
+// of each lane, as signed values, which holds every value multiplied here.
+EVAL_AVX2 inline __m256i mulWeight(__m256i lanes, int weight) {
+    return _mm256_mul_epi32(lanes, _mm256_set1_epi64x(weight));
+}
+
+// Adds weight * popcount of each lane to the sums
+EVAL_AVX2 inline __m256i addWeighted(__m256i sums, __m256i bits, int weight) {
+    return _mm256_add_epi64(sums, mulWeight(popcount256(bits), weight));
+}
+
+// Same as `countLines` on four positions
+EVAL_AVX2 inline void countLines256(__m256i tokens, __m256i counts[3]) {
+    counts[0] = counts[1] = counts[2] = _mm256_setzero_si256();
+
+    for (unsigned int dir = 0; dir < 4; dir++) {
+        unsigned int step = LINE_STEPS[dir];
+        __m256i a = tokens;
+        __m256i b = _mm256_srli_epi64(tokens, step);
+        __m256i c = _mm256_srli_epi64(tokens, 2 * step);
+        __m256i d = _mm256_srli_epi64(tokens, 3 * step);
+        __m256i e = _mm256_srli_epi64(tokens, 4 * step);
+
+        __m256i ab = _mm256_xor_si256(a, b);
+        __m256i s1 = _mm256_xor_si256(ab, c);
+        __m256i k1 = _mm256_or_si256(_mm256_and_si256(a, b),
+                                     _mm256_and_si256(ab, c));
+        __m256i s1d = _mm256_xor_si256(s1, d);
+        __m256i s2 = _mm256_xor_si256(s1d, e);
+        __m256i k2 = _mm256_or_si256(_mm256_and_si256(s1, d),
+                                     _mm256_and_si256(s1d, e));
+
+        __m256i starts = _mm256_set1_epi64x(LINE_STARTS.masks[dir]);
+        __m128i shift = _mm_cvtsi32_si128(LINE_PACK_SHIFTS[dir]);
+        counts[0] = _mm256_or_si256(
+            counts[0], _mm256_sll_epi64(_mm256_and_si256(s2, starts), shift));
+        counts[1] = _mm256_or_si256(
+            counts[1],
+            _mm256_sll_epi64(
+                _mm256_and_si256(_mm256_xor_si256(k1, k2), starts), shift));
+        counts[2] = _mm256_or_si256(
+            counts[2],
+            _mm256_sll_epi64(
+                _mm256_and_si256(_mm256_and_si256(k1, k2), starts), shift));
+    }
+}
+
+// Same as `openLinesScore` on four positions
+EVAL_AVX2 inline __m256i openLinesScore256(const __m256i own[3],
+                                           const __m256i other[3]) {
+    __m256i open = _mm256_andnot_si256(
+        _mm256_or_si256(_mm256_or_si256(other[0], other[1]), other[2]),
+        _mm256_set1_epi64x(LINE_STARTS.packed));
+    __m256i sums = _mm256_setzero_si256();
+
+    sums = addWeighted(
+        sums,
+        _mm256_andnot_si256(_mm256_or_si256(own[1], own[2]),
+                            _mm256_and_si256(open, own[0])),
+        openLineScore(1));
+    sums = addWeighted(
+        sums, _mm256_andnot_si256(own[0], _mm256_and_si256(open, own[1])),
+        openLineScore(2));
+    sums = addWeighted(
+        sums, _mm256_and_si256(_mm256_and_si256(open, own[1]), own[0]),
+        openLineScore(3));
+    sums = addWeighted(
+        sums, _mm256_andnot_si256(own[0], _mm256_and_si256(open, own[2])),
+        openLineScore(4));
+    sums = addWeighted(
+        sums, _mm256_and_si256(_mm256_and_si256(open, own[2]), own[0]),
+        openLineScore(5));
+
+    return sums;
+}
+
+// Evaluates the positions four at a time, leaving the rest to the scalar
+// code
+EVAL_AVX2 void evaluateBatchAvx2(const Position *positions,
+                                 const Token *players, size_t count,
+                                 int *scores) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        const Position *p = positions + i;
+        const Token *t = players + i;
+        __m256i own = _mm256_setr_epi64x(
+            p[0].tokens[t[0]], p[1].tokens[t[1]], p[2].tokens[t[2]],
+            p[3].tokens[t[3]]);
+        __m256i other = _mm256_setr_epi64x(p[0].tokens[otherPlayer(t[0])],
+                                           p[1].tokens[otherPlayer(t[1])],
+                                           p[2].tokens[otherPlayer(t[2])],
+                                           p[3].tokens[otherPlayer(t[3])]);
+
+        __m256i own_counts[3], other_counts[3];
+        countLines256(own, own_counts);
+        countLines256(other, other_counts);
+
+        __m256i score =
+            _mm256_sub_epi64(openLinesScore256(own_counts, other_counts),
+                             openLinesScore256(other_counts, own_counts));
+
+        // Quad control: the comparisons give -1 in lanes where they hold
+        __m256i quads = _mm256_setzero_si256();
+        for (unsigned int quad = 0; quad < QUAD_COUNT; quad++) {
+            __m256i mask = _mm256_set1_epi64x(QUAD_MASKS[quad]);
+            __m256i own_count = popcount256(_mm256_and_si256(own, mask));
+            __m256i other_count = popcount256(_mm256_and_si256(other, mask));
+            quads = _mm256_sub_epi64(
+                quads, _mm256_cmpgt_epi64(own_count, other_count));
+            quads = _mm256_add_epi64(
+                quads, _mm256_cmpgt_epi64(other_count, own_count));
+        }
+        score = _mm256_add_epi64(score, mulWeight(quads, QUAD_WEIGHT));
+
+        __m256i center = _mm256_set1_epi64x(CENTER_MASK);
+        score = addWeighted(score, _mm256_and_si256(own, center),
+                            CENTER_WEIGHT);
+        score = addWeighted(score, _mm256_and_si256(other, center),
+                            -CENTER_WEIGHT);
+
+        alignas(32) int64_t lanes[4];
+        _mm256_store_si256((__m256i *)lanes, score);
+        for (unsigned int lane = 0; lane < 4; lane++) {
+            scores[i + lane] = (int)lanes[lane];
+        }
+    }
+
+    for (; i < count; i++) {
+        scores[i] = evaluateSliced(positions[i].tokens[players[i]],
+                                   positions[i].tokens[otherPlayer(players[i])]);
+    }
+}
+
+bool evalPathSupported(EvalPath path) {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return path == EvalPath::ScalarEval || avx2;
+}
+
+#else
+
+bool evalPathSupported(EvalPath path) {
+    return path == EvalPath::ScalarEval;
+}
+
+#endif
+
+EvalPath bestEvalPath() {
+    return evalPathSupported(EvalPath::Avx2Eval) ? EvalPath::Avx2Eval
+                                                 : EvalPath::ScalarEval;
+}
+
+void evaluateBatch(const Position *positions, const Token *players,
+                   size_t count, int *scores, EvalPath path) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (path == EvalPath::Avx2Eval) {
+        evaluateBatchAvx2(positions, players, count, scores);
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < count; i++) {
+        scores[i] = evaluateSliced(positions[i].tokens[players[i]],
+                                   positions[i].tokens[otherPlayer(players[i])]);
+    }
+}
+
+void evaluateBatch(const Position *positions, const Token *players,
+                   size_t count, int *scores) {
+    static const EvalPath path = bestEvalPath();
+    evaluateBatch(positions, players, count, scores, path);
+}
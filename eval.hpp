@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+#include "position.hpp"
+
+// Static score of a position from the point of view of `player`, built from
+// token counts on open win lines, lines one token short of winning and
+// control of the quads
+int evaluate(const Position &position, Token player);
+
+// Batched evaluation, scoring many positions at once with the same results
+// as `evaluate`. The token counts of all win lines of a player are computed
+// together with bitwise adders, so the positions of a batch are evaluated
+// side by side in vector lanes when the CPU supports AVX2.
+enum EvalPath {
+    ScalarEval = 0,
+    Avx2Eval = 1,
+};
+
+bool evalPathSupported(EvalPath path);
+// Fastest path supported by the CPU
+EvalPath bestEvalPath();
+
+// Scores each position from the point of view of its player
+void evaluateBatch(const Position *positions, const Token *players,
+                   size_t count, int *scores);
+// Same on a given path, which has to be supported
+void evaluateBatch(const Position *positions, const Token *players,
+                   size_t count, int *scores, EvalPath path);
@@ -1,66 +1,30 @@
 #include "game.hpp"
 
+#include <chrono>
+#include <iomanip>
 #include <iostream>
 
+#include "notation.hpp"
 #include "util.hpp"
 
-const std::string nlu = "\u250c";  // ┌
-const std::string nlc = "\u251c";  // ├
-const std::string nld = "\u2514";  // └
-const std::string nru = "\u2510";  // ┐
-const std::string nrc = "\u2524";  // ┤
-const std::string nrd = "\u2518";  // ┘
-const std::string nmu = "\u252c";  // ┬
-const std::string nmc = "\u253c";  // ┼
-const std::string nmd = "\u2534";  // ┴
-const std::string nvv = "\u2502";  // │
-const std::string nhh = "\u2500";  // ─
-const std::string blu = "\u2554";  // ╔
-const std::string blc = "\u2560";  // ╠
-const std::string bld = "\u255a";  // ╚
-const std::string bru = "\u2557";  // ╗
-const std::string brc = "\u2563";  // ╣
-const std::string brd = "\u255d";  // ╝
-const std::string bmu = "\u2566";  // ╦
-const std::string bmc = "\u256c";  // ╬
-const std::string bmd = "\u2569";  // ╩
-const std::string bvv = "\u2551";  // ║
-const std::string bhh = "\u2550";  // ═
+// Interval of the analysis line updates between frames
+const unsigned int ANALYSIS_REFRESH_MS = 100;
+// Moves of the principal variation shown by the analysis
+const unsigned int ANALYSIS_PV_MOVES = 8;
 
 Game::Game(const std::string title) {
-    for (int y = 0; y < BOARD_SIZE; y++) {
-        for (int x = 0; x < BOARD_SIZE; x++) {
-            this->board[y][x] = Token::Empty;
-        }
-    }
+    this->position.clear();
 
     this->title = title;
-    this->players[Token::Player1] = { "Player 1", ' ' };
-    this->players[Token::Player2] = { "Player 2", ' ' };
+    this->players[Token::Player1] = { "Player 1", ' ', PlayerControl::Human };
+    this->players[Token::Player2] = { "Player 2", ' ', PlayerControl::Human };
 
     this->current_player = (Token)(rand() % 2);
 }
 
-// Constructs a string used for printing box-drawing borders
-std::string border(int seg_width, int seg_count, const std::string lcor,
-                   const std::string rcor, const std::string mid,
-                   const std::string sep) {
-    std::string out;
-
-    out.append(lcor);
-
-    for (int seg = 1; seg <= seg_count; seg++) {
-        for (int i = 1; i <= seg_width; i++) {
-            out.append(mid);
-            if (seg != seg_count && i == seg_width) {
-                out.append(sep);
-            }
-        }
-    }
-
-    out.append(rcor);
-
-    return out;
+Game::~Game() {
+    this->stopPondering();
+    this->stopAnalysis();
 }
 
 void waitForUnpause() {
@@ -70,72 +34,124 @@ void waitForUnpause() {
     std::cin.clear();
 }
 
+// Describes the state of the analysis in a single line
+std::string formatAnalysis(const AnalysisInfo &info) {
+    std::ostringstream out;
+    const SearchResult &result = info.result;
+
+    out << "Analysis: ";
+
+    if (result.depth == 0) {
+        out << (info.running ? "searching..." : "no result");
+        return out.str();
+    }
+
+    out << "depth " << result.depth << ", ";
+
+    if (result.score >= WIN_SCORE - (int)MAX_DEPTH) {
+        out << "win in " << WIN_SCORE - result.score;
+    } else if (result.score <= -(WIN_SCORE - (int)MAX_DEPTH)) {
+        out << "loss in " << WIN_SCORE + result.score;
+    } else {
+        out << "score " << result.score;
+    }
+
+    out << ", " << result.nodes << " nodes, pv";
+    for (unsigned int i = 0; i < std::min(result.pv_length, ANALYSIS_PV_MOVES);
+         i++) {
+        out << ' ' << formatMove(result.pv[i]);
+    }
+
+    if (!info.running) {
+        out << " (done)";
+    }
+
+    return out.str();
+}
+
+// Draws the board followed by the analysis, when it's running, and the
+// messages gathered since the last frame
 void Game::draw() {
-    // Amount of segments in each board region
-    int seg_n = BOARD_SIZE / 2;
-    // Width of one main border segment
-    int border_width = 3 * seg_n + seg_n + 2;
-    // Width of the entire game board
-    int board_width = border_width * 2 + 3;
-
-    // Game Title
-    int pad_len = (board_width - this->title.length()) / 2;
-    std::cout << std::string(pad_len, ' ') << this->title << std::endl;
-
-    // Top border
-    std::cout << border(border_width, 2, blu, bru, bhh, bhh) << std::endl;
-
-    for (int y = 0; y < BOARD_SIZE; y++) {
-        // Segment top border
-        if (y % (BOARD_SIZE / 2) == 0) {
-            std::cout << bvv << " " << border(3, seg_n, nlu, nru, nhh, nmu)
-                      << " " << border(3, seg_n, nlu, nru, nhh, nmu) << " "
-                      << bvv << std::endl;
-        }
+    char symbols[2] = { this->players[Token::Player1].symbol,
+                        this->players[Token::Player2].symbol };
 
-        // Row start
-        std::cout << bvv << " " << nvv;
+    this->syncAnalysis();
 
-        for (int x = 0; x < BOARD_SIZE; x++) {
-            if (this->board[y][x] == Token::Empty) {
-                std::cout << "   ";
-            } else {
-                std::cout << ' ' << this->players[this->board[y][x]].symbol
-                          << ' ';
-            }
+    std::string status = this->status.str();
+    if (this->analysis_shown) {
+        status = formatAnalysis(this->analysis->latest()) + "\n" + status;
+    }
 
-            if (x != BOARD_SIZE - 1) {
-                std::cout << nvv;
-            }
+    this->renderer.render(std::cout, this->title, this->position, symbols,
+                          status);
+    this->status.str("");
+}
 
-            if (x == BOARD_SIZE / 2 - 1) {
-                std::cout << " " << nvv;
-            }
-        }
+void Game::startAnalysis() {
+    if (!this->analysis) {
+        this->analysis.reset(new Analysis());
+        this->analysis->setThreads(this->threads);
+        this->analysis->setTablebase(this->tablebase);
+        this->analysis->setNetwork(this->network);
+    }
 
-        // Row end
-        std::cout << nvv << " " << bvv << std::endl;
+    this->analysis_shown = true;
+    this->analysis_display = std::thread(&Game::showAnalysis, this);
+}
 
-        // Segment bottom border and segment separator
-        if (y % (BOARD_SIZE / 2) == BOARD_SIZE / 2 - 1) {
-            std::cout << bvv << " " << border(3, seg_n, nld, nrd, nhh, nmd)
-                      << " " << border(3, seg_n, nld, nrd, nhh, nmd) << " "
-                      << bvv << std::endl;
-        } else {
-            std::cout << bvv << " " << border(3, seg_n, nlc, nrc, nhh, nmc)
-                      << " " << border(3, seg_n, nlc, nrc, nhh, nmc) << " "
-                      << bvv << std::endl;
-        }
+void Game::stopAnalysis() {
+    if (!this->analysis_shown) {
+        return;
+    }
+
+    this->analysis_shown = false;
+    this->analysis_display.join();
+    this->analysis->stop();
+}
+
+// Moves the analysis to the current position, or ends it with the game
+void Game::syncAnalysis() {
+    if (!this->analysis_shown) {
+        return;
     }
 
-    // Bottom border
-    std::cout << border(border_width, 2, bld, brd, bhh, bhh) << std::endl;
+    bool playing = this->state == GameState::TicTacToe ||
+                   this->state == GameState::Pentago;
+
+    if (!playing || winners(this->position) != 0 || this->position.full()) {
+        this->stopAnalysis();
+    } else if (!this->analysis->analyses(this->position,
+                                         this->current_player)) {
+        this->analysis->start(this->position, this->current_player,
+                              this->state == GameState::Pentago);
+    }
+}
+
+// Runs on its own thread, redrawing the analysis line whenever the search
+// publishes a new result, also while the game waits for input
+void Game::showAnalysis() {
+    AnalysisInfo shown = {};
+
+    while (this->analysis_shown) {
+        AnalysisInfo info = this->analysis->latest();
+
+        if (info.running != shown.running ||
+            info.result.depth != shown.result.depth ||
+            info.result.nodes != shown.result.nodes) {
+            this->renderer.renderStatusLine(std::cout, 0,
+                                            formatAnalysis(info));
+            shown = info;
+        }
+
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(ANALYSIS_REFRESH_MS));
+    }
 }
 
 void Game::drawStats() {
-    std::cout << "Current player: " << this->players[this->current_player].name
-              << " (" << this->players[this->current_player].symbol << ")"
-              << std::endl;
+    const Player &player = this->players[this->current_player];
+    this->status << "Current player: " << player.name << " (" << player.symbol
+                 << ")" << std::endl;
 }
 
 void Game::drawHelp() {
@@ -158,6 +174,11 @@ void Game::drawHelp() {
               << "Other commands:" << std::endl
               << "\tp - pause the game, stopping the timer" << std::endl
               << "\th - show help (this screen)" << std::endl
+              << "\tu - undo the last move" << std::endl
+              << "\tr - redo an undone move" << std::endl
+              << "\te - start or stop analysing the position in the "
+                 "background"
+              << std::endl
               << "\to - load an example predefined board" << std::endl
               << "\tm - menu, where you can change your name and token symbol"
               << std::endl
@@ -258,14 +279,22 @@ void Game::update() {
     switch (this->state) {
         case TicTacToe:
         case Pentago:
-            this->draw();
             this->drawStats();
-            this->handleInput();
-            this->checkWinCondition(5);
+            this->draw();
+            if (this->players[this->current_player].control !=
+                PlayerControl::Human) {
+                this->playEngineMove();
+            } else {
+                this->startPondering();
+                this->handleInput();
+                this->finishPondering();
+            }
+            this->checkWinCondition();
             break;
         case Win:
             this->draw();
             this->drawEnd();
+            this->saveRecord();
             this->state = GameState::End;
             break;
         default:
@@ -273,24 +302,6 @@ void Game::update() {
     }
 }
 
-// Calculates the relative offset used for rotating and placing tokens
-void quadOffset(const char q, int *y, int *x) {
-    switch (q) {
-        case 'w':
-            *x = BOARD_SIZE / 2;
-            break;
-        case 'a':
-            *y = BOARD_SIZE / 2;
-            break;
-        case 's':
-            *x = BOARD_SIZE / 2;
-            *y = BOARD_SIZE / 2;
-            break;
-        default:
-            break;
-    }
-}
-
 // Parses user input and decides what to do with it
 void Game::handleInput() {
     // Get user input
@@ -299,351 +310,453 @@ void Game::handleInput() {
     std::cin >> input;
     std::cin.clear();
 
-    clearScreen();
-
-    // Parse input
-    int input_len = input.length();
-    int input_num;
-    char input_rot, input_rot_dir;
-    int y = 0, x = 0, rot_y = 0, rot_x = 0;
-    bool rotate = false;
+    Move move;
 
     switch (input[0]) {
         case 'q':
         case 'w':
         case 'a':
         case 's':
-            if (input_len < 2) {
-                if (this->state == GameState::TicTacToe) {
-                    std::cout << "Input a move.";
-
-                } else if (this->state == GameState::Pentago) {
-                    std::cout << "Input a move and (optionally) a rotation.";
-                }
-
-                break;
-            }
-
-            if (input_len >= 2) {
-                input_num = input[1] - '0';
-
-                if (input_num < 1 || input_num > 9) {
-                    std::cout << "Enter a number between 1 and 9.";
-                    break;
-                }
-            }
-
-            // Rotation input is checked before making any changes to the board
-            // in order to prevent accidental user input erorrs
-            if (this->state == GameState::Pentago) {
-                if (input_len >= 3) {
-                    input_rot = input[2];
-
-                    if (input_rot != 'q' && input_rot != 'w' &&
-                        input_rot != 'a' && input_rot != 's') {
-                        std::cout << "Choose a correct quad (q/w/a/s).";
-                        break;
+            switch (parseMove(input, this->state == GameState::Pentago,
+                              &move)) {
+                case MoveParseResult::MissingField:
+                    if (this->state == GameState::TicTacToe) {
+                        this->status << "Input a move.";
+                    } else {
+                        this->status
+                            << "Input a move and (optionally) a rotation.";
                     }
-
-                    if (input_len < 4) {
-                        std::cout << "Input a rotation direction (z or x).";
-                        break;
-                    }
-                }
-
-                if (input_len >= 4) {
-                    input_rot_dir = input[3];
-
-                    if (input_rot_dir != 'z' && input_rot_dir != 'x') {
-                        std::cout << "Choose a correct rotation (z or x).";
-                        break;
+                    break;
+                case MoveParseResult::InvalidField:
+                    this->status << "Enter a number between 1 and 9.";
+                    break;
+                case MoveParseResult::InvalidRotation:
+                    this->status << "Choose a correct quad (q/w/a/s).";
+                    break;
+                case MoveParseResult::MissingDirection:
+                    this->status << "Input a rotation direction (z or x).";
+                    break;
+                case MoveParseResult::InvalidDirection:
+                    this->status << "Choose a correct rotation (z or x).";
+                    break;
+                default:
+                    if (this->playMove(move) != 0) {
+                        this->status << "This spot is taken.";
                     }
-
-                    rotate = true;
-                }
-            }
-
-            quadOffset(input[0], &y, &x);
-
-            y += (BOARD_SIZE / 2 - 1) - (input_num - 1) / (BOARD_SIZE / 2);
-            x += (input_num - 1) % (BOARD_SIZE / 2);
-
-            if (this->placeToken(y, x, this->current_player) != 0) {
-                std::cout << "This spot is taken.";
-                break;
-            }
-
-            if (this->state == GameState::Pentago && rotate) {
-                quadOffset(input_rot, &rot_y, &rot_x);
-                if (input_rot_dir == 'z') {
-                    this->rotateQuadRight(rot_y, rot_x);
-                } else if (input_rot_dir == 'x') {
-                    this->rotateQuadLeft(rot_y, rot_x);
-                }
+                    break;
             }
 
-            this->setCurrentPlayer(this->current_player == Token::Player1
-                                       ? Token::Player2
-                                       : Token::Player1);
-
             break;
 
         case 'p':
+            this->renderer.invalidate();
             this->drawPause();
             waitForUnpause();
-            clearScreen();
+            break;
+
+        case 'u':
+            if (this->undoMove() != 0) {
+                this->status << "There are no moves to undo.";
+            } else {
+                this->status << "Move undone.";
+            }
+            break;
+
+        case 'r':
+            if (this->redoMove() != 0) {
+                this->status << "There are no moves to redo.";
+            } else {
+                this->status << "Move redone.";
+            }
             break;
 
         case 'o':
             this->loadExampleBoard();
-            std::cout << "Loaded example board";
+            this->status << "Loaded example board";
             break;
 
         case 'm':
+            this->renderer.invalidate();
             this->drawMenu();
-            clearScreen();
             break;
 
         case 'h':
+            this->renderer.invalidate();
             Game::drawHelp();
             waitForUnpause();
-            clearScreen();
+            break;
+
+        case 'e':
+            if (this->analysis_shown) {
+                this->stopAnalysis();
+                this->status << "Analysis stopped.";
+            } else {
+                this->startAnalysis();
+                this->status << "Analysis started.";
+            }
             break;
 
         case 'z':
-            std::cout << "Thanks for playing " << this->title << "!";
+            std::cout << "Thanks for playing " << this->title << "!"
+                      << std::endl;
+            this->saveRecord();
             this->setState(GameState::End);
             break;
 
         default:
-            std::cout << "This command doesn't exist. Check the 'h' "
+            this->status << "This command doesn't exist. Check the 'h' "
                          "command for help.";
             break;
     }
 
-    std::cout << std::endl << std::endl;
+    this->status << std::endl << std::endl;
 }
 
-// Checks the win condition with at least `n_crossed` tokens in a row
-void Game::checkWinCondition(unsigned int n_crossed) {
-    // Vertical and horizontal win conditions
-    for (int y = 0; y < BOARD_SIZE; y++) {
-        int streak_h = 0, streak_v = 0;
-        Token streak_h_player = Token::Empty, streak_v_player = Token::Empty;
+// Plays a move for the current player and passes the turn to the other one
+int Game::playMove(Move move) {
+    Position before = this->position;
+    int err = this->placeToken(move.cell / BOARD_SIZE, move.cell % BOARD_SIZE,
+                               this->current_player);
+    if (err != 0) {
+        return err;
+    }
 
-        for (int x = 0; x < BOARD_SIZE; x++) {
-            // Horizontal
-            if (streak_h_player != this->board[y][x]) {
-                streak_h_player = this->board[y][x];
-                streak_h = 1;
-            } else {
-                streak_h++;
-            }
+    if (this->history.size() == 0) {
+        this->record_start = before;
+        this->record_first = this->current_player;
+        this->record_rotations = this->state == GameState::Pentago;
+    }
 
-            // Vertical
-            if (streak_v_player != this->board[x][y]) {
-                streak_v_player = this->board[x][y];
-                streak_v = 1;
-            } else {
-                streak_v++;
-            }
+    if (move.rotation != NO_ROTATION) {
+        unsigned int origin = quadOrigin(move.rotation / 2);
+        unsigned int y = origin / BOARD_SIZE, x = origin % BOARD_SIZE;
 
-            // Draw
-            if (streak_h >= n_crossed && streak_v >= n_crossed &&
-                streak_h_player != Token::Empty &&
-                streak_v_player != Token::Empty) {
-                this->state = GameState::Win;
-                this->end_state = EndState::Draw;
-                return;
-            }
+        if (move.rotation % 2 == Rotation::Clockwise) {
+            this->rotateQuadRight(y, x);
+        } else {
+            this->rotateQuadLeft(y, x);
+        }
+    }
 
-            // Horizontal win
-            if (streak_h >= n_crossed && streak_h_player != Token::Empty) {
-                this->state = GameState::Win;
-                this->end_state = (EndState)streak_h_player;
-                return;
-            }
+    this->history.push(move, this->current_player);
+    this->last_move = move;
+    this->moved = true;
+    this->setCurrentPlayer(otherPlayer(this->current_player));
 
-            // Vertical win
-            if (streak_v >= n_crossed && streak_v_player != Token::Empty) {
-                this->state = GameState::Win;
-                this->end_state = (EndState)streak_v_player;
-                return;
-            }
-        }
+    return 0;
+}
+
+// Takes back the last move, along with the computer's moves before it, so
+// that a human player gets to move again
+int Game::undoMove() {
+    if (!this->history.canUndo()) {
+        return -1;
     }
 
-    // Diagonal win conditions
-    int streak_dr = 0, streak_dl = 0;
-    Token streak_dr_player = Token::Empty, streak_dl_player = Token::Empty;
+    do {
+        MoveRecord record = this->history.undo(&this->position);
+        this->setCurrentPlayer(record.player);
+    } while (this->players[this->current_player].control !=
+                 PlayerControl::Human &&
+             this->history.canUndo());
 
-    for (int i = 0; i < BOARD_SIZE; i++) {
-        // Diagonal going down
-        if (streak_dr_player != this->board[i][i]) {
-            streak_dr_player = this->board[i][i];
-            streak_dr = 1;
-        } else {
-            streak_dr++;
-        }
+    // The position before any move was checked already
+    this->moved = false;
 
-        // Diagonal going up
-        if (streak_dl_player != this->board[i][i]) {
-            streak_dl_player = this->board[i][i];
-            streak_dl = 1;
-        } else {
-            streak_dl++;
-        }
+    return 0;
+}
 
-        // Diagonal going down win
-        if (streak_dr >= n_crossed && streak_dr_player != Token::Empty) {
-            this->state = GameState::Win;
-            this->end_state = (EndState)streak_dr_player;
-            return;
-        }
+// Plays an undone move again, along with the computer's moves after it
+int Game::redoMove() {
+    if (!this->history.canRedo()) {
+        return -1;
+    }
 
-        // Diagonal going up win
-        if (streak_dl >= n_crossed && streak_dl_player != Token::Empty) {
-            this->state = GameState::Win;
-            this->end_state = (EndState)streak_dl_player;
-            return;
+    do {
+        MoveRecord record = this->history.redo(&this->position);
+        this->setCurrentPlayer(otherPlayer(record.player));
+        this->last_move = record.move;
+        this->moved = true;
+
+        // Stop at a won position, checking each redone move separately
+        if (winnersAfterMove(this->position, record.move) != 0) {
+            break;
         }
+    } while (this->players[this->current_player].control !=
+                 PlayerControl::Human &&
+             this->history.canRedo());
+
+    return 0;
+}
+
+// Lets the current player's engine search and play a move
+void Game::playEngineMove() {
+    if (this->players[this->current_player].control ==
+        PlayerControl::MonteCarlo) {
+        this->playMctsMove();
+    } else {
+        this->playSearchMove();
     }
+}
 
-    // Offset diagonal win conditions
-    int streak_dra = 0, streak_dru = 0, streak_dla = 0, streak_dlu = 0;
-    Token streak_dra_player = Token::Empty, streak_dru_player = Token::Empty,
-          streak_dla_player = Token::Empty, streak_dlu_player = Token::Empty;
+void Game::playSearchMove() {
+    SearchLimits limits;
+    limits.time_ms = ENGINE_MOVE_TIME_MS;
+
+    // The time spent pondering on this position counts towards the budget
+    // when pondering finished an iteration. Otherwise a spent budget would
+    // leave the search below without any limit.
+    unsigned int saved_ms = 0;
+    bool pondered = this->ponder_hit && this->ponder_result.depth > 0;
+    if (pondered) {
+        saved_ms = std::min(this->ponder_ms, ENGINE_MOVE_TIME_MS);
+        limits.time_ms -= saved_ms;
+        this->ponder_stats.saved_ms += saved_ms;
+    }
 
-    for (int i = 0, j = 1; j < BOARD_SIZE; i++, j++) {
-        // Going down above middle
-        if (streak_dra_player != this->board[i][j]) {
-            streak_dra_player = this->board[i][j];
-            streak_dra = 1;
-        } else {
-            streak_dra++;
-        }
+    Player player = this->players[this->current_player];
+    SearchResult result;
+    if (pondered && limits.time_ms == 0) {
+        result = this->ponder_result;
+    } else {
+        result = this->engine.search(this->position, this->current_player,
+                                     this->state == GameState::Pentago,
+                                     limits);
+    }
 
-        // Going down under middle
-        if (streak_dru_player != this->board[j][i]) {
-            streak_dru_player = this->board[j][i];
-            streak_dru = 1;
+    this->playMove(result.best_move);
+
+    // The second move of the principal variation is the expected reply
+    this->has_prediction = result.pv_length >= 2;
+    this->prediction_from = this->position;
+    this->predicted_reply = result.pv[1];
+
+    this->status << player.name << " (" << player.symbol << ") played "
+                 << formatMove(result.best_move) << " ("
+                 << (result.from_book ? "book, " : "") << "depth "
+                 << result.depth
+                 << ", score " << result.score << ", " << result.nodes
+                 << " nodes)";
+    if (this->has_prediction) {
+        this->status << ", expecting " << formatMove(this->predicted_reply);
+    }
+    this->status << std::endl;
+
+    const TTStats &tt = result.tt;
+    this->status << std::fixed << std::setprecision(1)
+                 << "Transposition table: "
+                 << percent(tt.hits, tt.probes) << "% hits, "
+                 << percent(tt.collisions, tt.probes) << "% collisions, "
+                 << percent(tt.used, tt.size) << "% used" << std::endl
+                 << "Move generation: " << result.unique_moves << " unique of "
+                 << result.raw_moves << " moves ("
+                 << percent(result.unique_moves, result.raw_moves) << "%)"
+                 << std::endl;
+
+    const PonderStats &ponder = this->ponder_stats;
+    if (ponder.predictions > 0) {
+        this->status << "Pondering: ";
+        if (this->ponder_hit) {
+            this->status << "hit, " << saved_ms << " ms saved";
         } else {
-            streak_dru++;
+            this->status << "no hit";
         }
+        this->status << " (" << ponder.hits << " of " << ponder.predictions
+                     << " predicted, "
+                     << percent(ponder.hits, ponder.predictions) << "%, "
+                     << ponder.saved_ms << " ms saved in total)" << std::endl;
+    }
 
-        // Going up above middle
-        if (streak_dla_player != this->board[i][BOARD_SIZE - j]) {
-            streak_dla_player = this->board[i][BOARD_SIZE - j];
-            streak_dla = 1;
-        } else {
-            streak_dla++;
-        }
+    this->status << std::endl;
+    this->ponder_hit = false;
+}
 
-        // Going up under middle
-        if (streak_dlu_player != this->board[BOARD_SIZE - j][j]) {
-            streak_dlu_player = this->board[BOARD_SIZE - j][j];
-            streak_dlu = 1;
-        } else {
-            streak_dlu++;
-        }
+// Starts searching the position after the predicted reply of the human
+// player, unless it's already being searched
+void Game::startPondering() {
+    Token engine_player = otherPlayer(this->current_player);
 
-        // Draw going down
-        if (streak_dra >= n_crossed && streak_dru >= n_crossed &&
-            streak_dra_player != Token::Empty &&
-            streak_dru_player != Token::Empty) {
-            this->state = GameState::Win;
-            this->end_state = EndState::Draw;
-            return;
-        }
+    if (this->ponder_thread.joinable() || !this->has_prediction ||
+        this->players[engine_player].control != PlayerControl::AlphaBeta ||
+        !samePosition(this->position, this->prediction_from)) {
+        return;
+    }
 
-        // Draw going up
-        if (streak_dla >= n_crossed && streak_dlu >= n_crossed &&
-            streak_dla_player != Token::Empty &&
-            streak_dlu_player != Token::Empty) {
-            this->state = GameState::Win;
-            this->end_state = EndState::Draw;
-            return;
-        }
+    Position predicted = this->position;
+    predicted.makeMove(this->predicted_reply, this->current_player);
+    if (winnersAfterMove(predicted, this->predicted_reply) != 0 ||
+        predicted.full()) {
+        return;
+    }
 
-        // Going down under win
-        if (streak_dru >= n_crossed && streak_dru_player != Token::Empty) {
-            this->state = GameState::Win;
-            this->end_state = (EndState)streak_dru_player;
-            return;
-        }
+    this->ponder_position = predicted;
+    this->ponder_cancel = false;
+    this->ponder_start = std::chrono::steady_clock::now();
+
+    bool rotations = this->state == GameState::Pentago;
+    this->ponder_thread = std::thread([this, engine_player, rotations]() {
+        SearchLimits limits;
+        limits.cancel = &this->ponder_cancel;
+        this->ponder_result = this->engine.search(
+            this->ponder_position, engine_player, rotations, limits);
+    });
+}
 
-        // Going down above win
-        if (streak_dra >= n_crossed && streak_dra_player != Token::Empty) {
-            this->state = GameState::Win;
-            this->end_state = (EndState)streak_dra_player;
-            return;
-        }
+// Stops pondering once the human player moved, checking whether the
+// prediction was right. Keeps pondering when the position didn't change.
+void Game::finishPondering() {
+    if (!this->ponder_thread.joinable() ||
+        samePosition(this->position, this->prediction_from)) {
+        return;
+    }
 
-        // Going up under win
-        if (streak_dlu >= n_crossed && streak_dlu_player != Token::Empty) {
-            this->state = GameState::Win;
-            this->end_state = (EndState)streak_dlu_player;
-            return;
-        }
+    unsigned int elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - this->ponder_start)
+            .count();
+    this->stopPondering();
 
-        // Going up above win
-        if (streak_dla >= n_crossed && streak_dla_player != Token::Empty) {
-            this->state = GameState::Win;
-            this->end_state = (EndState)streak_dla_player;
-            return;
-        }
+    // Undoing moves or loading a board isn't a reply
+    if (this->players[this->current_player].control !=
+        PlayerControl::AlphaBeta) {
+        return;
     }
-}
 
-// Rotates a board subsection
-void Game::rotateQuadRight(unsigned int y, unsigned int x) {
-    // Transpose the quad
-    for (int row = 0; row < BOARD_SIZE / 2; row++) {
-        for (int col = row; col < BOARD_SIZE / 2; col++) {
-            std::swap(this->board[y + row][x + col],
-                      this->board[y + col][x + row]);
-        }
+    this->ponder_stats.predictions++;
+
+    if (samePosition(this->position, this->ponder_position)) {
+        this->ponder_stats.hits++;
+        this->ponder_hit = true;
+        this->ponder_ms = elapsed;
     }
+}
 
-    // Mirror the board horizontally
-    for (int row = 0; row < BOARD_SIZE / 2; row++) {
-        for (int col = 0; col < BOARD_SIZE / 2 / 2; col++) {
-            std::swap(this->board[y + row][x + col],
-                      this->board[y + row][x + BOARD_SIZE / 2 - 1 - col]);
-        }
+void Game::stopPondering() {
+    if (this->ponder_thread.joinable()) {
+        this->ponder_cancel = true;
+        this->ponder_thread.join();
     }
+
+    this->has_prediction = false;
 }
 
-// Shortcut for using `rotateQuadRight` 3 times
-void Game::rotateQuadLeft(unsigned int y, unsigned int x) {
-    for (int i = 0; i < 3; i++) {
-        this->rotateQuadRight(y, x);
+void Game::playMctsMove() {
+    MctsLimits limits;
+    limits.time_ms = ENGINE_MOVE_TIME_MS;
+
+    Player player = this->players[this->current_player];
+    MctsResult result =
+        this->mcts->search(this->position, this->current_player,
+                           this->state == GameState::Pentago, limits);
+
+    this->playMove(result.best_move);
+
+    this->status << std::fixed << std::setprecision(1) << player.name << " ("
+                 << player.symbol << ") played " << formatMove(result.best_move)
+                 << " (" << result.playouts << " playouts, "
+                 << 100 * result.win_rate << "% win rate)" << std::endl
+                 << "Monte Carlo: "
+                 << (result.time_ms ? result.playouts * 1000 / result.time_ms
+                                    : result.playouts)
+                 << " playouts/s, " << result.tree_nodes << " nodes ("
+                 << result.arena_bytes / (1024.0 * 1024.0) << " MB), "
+                 << result.reused_nodes << " reused ("
+                 << 100 * result.reuse_ratio << "% of the previous tree)"
+                 << std::endl
+                 << std::endl;
+}
+
+// Appends the moves played so far to the game records, with the result
+// when the game has ended
+void Game::saveRecord() {
+    if (this->records == nullptr || this->history.size() == 0) {
+        return;
+    }
+
+    GameRecord record;
+    startRecord(this->record_start, this->record_first,
+                this->record_rotations, &record);
+    for (Token player : { Token::Player1, Token::Player2 }) {
+        setRecordPlayer(player, this->players[player].name,
+                        this->players[player].symbol, &record);
+    }
+    for (unsigned int i = 0; i < this->history.size(); i++) {
+        recordMove(this->history.at(i).move, &record);
+    }
+    if (this->state == GameState::Win) {
+        record.header.result = this->end_state;
+    }
+
+    if (!this->records->write(record) || !this->records->flush()) {
+        std::cout << "Can't write the game record." << std::endl;
     }
 }
 
-// Fills the game board by parsing a simplified board
-//
-// 0 - Empty field
-// 1 - Player 1
-// 2 - Player 2
-void Game::fillBoard(const int board[BOARD_SIZE][BOARD_SIZE]) {
-    for (int y = 0; y < BOARD_SIZE; y++) {
-        for (int x = 0; x < BOARD_SIZE; x++) {
-            switch (board[y][x]) {
-                case 0:
-                    this->board[y][x] = Token::Empty;
-                    break;
-                case 1:
-                    this->board[y][x] = Token::Player1;
-                    break;
-                case 2:
-                    this->board[y][x] = Token::Player2;
-                    break;
+// Checks whether any player has completed a line of WIN_LENGTH tokens,
+// ending the game. After a single move only the lines it touched are tested.
+void Game::checkWinCondition() {
+    unsigned int result;
+
+    if (this->board_replaced) {
+        result = winners(this->position);
+    } else if (this->moved) {
+        result = winnersAfterMove(this->position, this->last_move,
+                                  &this->win_check_stats);
+    } else {
+        return;
+    }
+
+    this->board_replaced = false;
+    this->moved = false;
+
+    switch (result) {
+        case WINNER_PLAYER1:
+            this->state = GameState::Win;
+            this->end_state = EndState::Player1Win;
+            break;
+        case WINNER_PLAYER2:
+            this->state = GameState::Win;
+            this->end_state = EndState::Player2Win;
+            break;
+        case WINNER_PLAYER1 | WINNER_PLAYER2:
+            this->state = GameState::Win;
+            this->end_state = EndState::Draw;
+            break;
+        default:
+            // No more moves can be made
+            if (this->position.full()) {
+                this->state = GameState::Win;
+                this->end_state = EndState::Draw;
             }
-        }
+            break;
     }
 }
 
+// Rotates a board subsection clockwise
+void Game::rotateQuadRight(unsigned int y, unsigned int x) {
+    this->position.rotateQuad(quadIndex(y, x), Rotation::Clockwise);
+}
+
+// Rotates a board subsection anti-clockwise
+void Game::rotateQuadLeft(unsigned int y, unsigned int x) {
+    this->position.rotateQuad(quadIndex(y, x), Rotation::AntiClockwise);
+}
+
+// Fills the game board by parsing a simplified board, see `fillPosition`
+void Game::fillBoard(const int board[BOARD_SIZE][BOARD_SIZE]) {
+    fillPosition(&this->position, board);
+
+    this->board_replaced = true;
+    this->history.clear();
+}
+
+void Game::clearBoard() {
+    this->position.clear();
+
+    this->board_replaced = true;
+    this->history.clear();
+}
+
 int Game::setPlayerName(Token player, const std::string name) {
     if (name.length() > MAX_PLAYER_NAME_LEN) {
         return -1;
@@ -654,6 +767,42 @@ int Game::setPlayerName(Token player, const std::string name) {
     return 0;
 }
 
+void Game::setPlayerControl(Token player, PlayerControl control) {
+    this->players[player].control = control;
+
+    if (control == PlayerControl::MonteCarlo && !this->mcts) {
+        this->mcts.reset(new MctsEngine());
+        this->mcts->setThreads(this->threads);
+    }
+}
+
+void Game::setTablebase(const Tablebase *tablebase) {
+    this->tablebase = tablebase;
+    this->engine.setTablebase(tablebase);
+    if (this->analysis) {
+        this->analysis->setTablebase(tablebase);
+    }
+}
+
+void Game::setNetwork(const Network *network) {
+    this->network = network;
+    this->engine.setNetwork(network);
+    if (this->analysis) {
+        this->analysis->setNetwork(network);
+    }
+}
+
+void Game::setEngineThreads(unsigned int threads) {
+    this->threads = threads;
+    this->engine.setThreads(threads);
+    if (this->analysis) {
+        this->analysis->setThreads(threads);
+    }
+    if (this->mcts) {
+        this->mcts->setThreads(threads);
+    }
+}
+
 int Game::setPlayerSymbol(Token player, const char symbol) {
     if (this->players[Token::Player1].symbol == symbol ||
         this->players[Token::Player2].symbol == symbol) {
@@ -665,13 +814,14 @@ int Game::setPlayerSymbol(Token player, const char symbol) {
     return 0;
 }
 
-// Example board used in the 'o' command
+// Example board used in the 'o' command, with Player 2 to move
+const int EXAMPLE_BOARD[BOARD_SIZE][BOARD_SIZE] = {
+    { 0, 1, 0, 0, 2, 0 }, { 2, 2, 1, 2, 1, 0 }, { 0, 2, 0, 0, 0, 0 },
+    { 2, 2, 0, 0, 0, 0 }, { 1, 0, 2, 0, 1, 0 }, { 0, 1, 0, 0, 1, 1 },
+};
+
 void Game::loadExampleBoard() {
-    const int example_board[BOARD_SIZE][BOARD_SIZE] = {
-        { 0, 1, 0, 0, 2, 0 }, { 2, 2, 1, 2, 1, 0 }, { 0, 2, 0, 0, 0, 0 },
-        { 2, 2, 0, 0, 0, 0 }, { 1, 0, 2, 0, 1, 0 }, { 0, 1, 0, 0, 1, 1 },
-    };
-    this->fillBoard(example_board);
+    this->fillBoard(EXAMPLE_BOARD);
     this->setPlayerName(Token::Player1, "Blue");
     this->setPlayerSymbol(Token::Player1, 'x');
     this->setPlayerName(Token::Player2, "Red");
@@ -681,15 +831,15 @@ void Game::loadExampleBoard() {
 
 // Place a token with all the approperiate checks
 int Game::placeToken(unsigned int y, unsigned int x, Token token) {
-    if (y < 0 || y > BOARD_SIZE || x < 0 || x > BOARD_SIZE) {
+    if (y >= BOARD_SIZE || x >= BOARD_SIZE) {
         return -1;
     }
 
-    if (this->board[y][x] != Token::Empty) {
+    if (this->position.occupied() & cellBit(y, x)) {
         return -2;
     }
 
-    this->board[y][x] = token;
+    this->position.place(cellIndex(y, x), token);
 
     return 0;
 }
@@ -1,9 +1,24 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <thread>
+
+#include "analysis.hpp"
+#include "history.hpp"
+#include "mcts.hpp"
+#include "position.hpp"
+#include "record.hpp"
+#include "renderer.hpp"
+#include "search.hpp"
 
-const unsigned int BOARD_SIZE = 6;
-static_assert(BOARD_SIZE % 2 == 0);
 const unsigned int MAX_PLAYER_NAME_LEN = 10;
 
+extern const int EXAMPLE_BOARD[BOARD_SIZE][BOARD_SIZE];
+
 enum GameState {
     Setup,
     Win,
@@ -18,15 +33,22 @@ enum EndState {
     Draw = 2,
 };
 
-enum Token {
-    Player1 = 0,
-    Player2 = 1,
-    Empty = 2,
+enum PlayerControl {
+    Human = 0,
+    AlphaBeta = 1,   // Moves are chosen by the alpha-beta engine
+    MonteCarlo = 2,  // Moves are chosen by the Monte Carlo engine
+};
+
+struct PonderStats {
+    uint64_t predictions;  // Human moves made while the engine pondered
+    uint64_t hits;         // Predicted correctly
+    uint64_t saved_ms;     // Search time saved by the hits
 };
 
 struct Player {
     std::string name;
     char symbol;
+    PlayerControl control;
 };
 
 class Game {
@@ -34,13 +56,62 @@ class Game {
     std::string title;
     GameState state = GameState::Setup;
     EndState end_state;
-    Token board[BOARD_SIZE][BOARD_SIZE];
+    Position position;
     Player players[2];
     Token current_player;
+    // Changes made since the last win condition check
+    bool board_replaced = false;
+    bool moved = false;
+    Move last_move;
+    WinCheckStats win_check_stats = {};
+    MoveStack history;
+    // Finished and abandoned games are appended to the records, starting
+    // from the position before the first move in the history
+    GameRecordWriter *records = nullptr;
+    Position record_start;
+    Token record_first;
+    bool record_rotations;
+    Engine engine;
+    std::unique_ptr<MctsEngine> mcts;  // Created for the first MCTS player
+    unsigned int threads = 1;
+    const Tablebase *tablebase = nullptr;
+    const Network *network = nullptr;
+    BoardRenderer renderer;
+    // Messages shown below the board in the next frame
+    std::ostringstream status;
+    // Created on the first use of the analysis command
+    std::unique_ptr<Analysis> analysis;
+    // Keeps the analysis line below the board up to date between frames
+    std::thread analysis_display;
+    std::atomic<bool> analysis_shown{ false };
+    // Pondering: while a human player thinks, the engine of the other player
+    // searches the position after the reply it predicted
+    bool has_prediction = false;
+    Position prediction_from;  // The human player's position
+    Move predicted_reply;
+    Position ponder_position;  // After the predicted reply
+    std::thread ponder_thread;
+    std::atomic<bool> ponder_cancel{ false };
+    std::chrono::steady_clock::time_point ponder_start;
+    SearchResult ponder_result;
+    bool ponder_hit = false;
+    unsigned int ponder_ms = 0;  // Time pondered before the hit
+    PonderStats ponder_stats = {};
+    void startPondering();
+    void finishPondering();
+    void stopPondering();
+    void startAnalysis();
+    void stopAnalysis();
+    void syncAnalysis();
+    void showAnalysis();
+    void playSearchMove();
+    void playMctsMove();
     void setCurrentPlayer(Token player) { this->current_player = player; }
+    void saveRecord();
 
    public:
     Game(const std::string title);
+    ~Game();
     void draw();
     void drawStats();
     static void drawHelp();
@@ -49,14 +120,33 @@ class Game {
     void drawEnd();
     void update();
     void handleInput();
-    void checkWinCondition(unsigned int n_crossed);
+    void playEngineMove();
+    int playMove(Move move);
+    int undoMove();
+    int redoMove();
+    void checkWinCondition();
     void rotateQuadRight(unsigned int y, unsigned int x);
     void rotateQuadLeft(unsigned int y, unsigned int x);
     bool active() { return this->state != GameState::End; }
     void setState(GameState state) { this->state = state; }
     void fillBoard(const int board[BOARD_SIZE][BOARD_SIZE]);
+    void clearBoard();
     int setPlayerName(Token player, const std::string name);
     int setPlayerSymbol(Token player, const char symbol);
+    void setPlayerControl(Token player, PlayerControl control);
+    void setEngineThreads(unsigned int threads);
+    void setTablebase(const Tablebase *tablebase);
+    void setNetwork(const Network *network);
+    void setBook(const OpeningBook *book) { this->engine.setBook(book); }
+    void setRecords(GameRecordWriter *records) { this->records = records; }
     void loadExampleBoard();
-    int placeToken(uint y, uint x, Token token);
+    int placeToken(unsigned int y, unsigned int x, Token token);
+    const Position &getPosition() const { return this->position; }
+    Token tokenAt(unsigned int y, unsigned int x) const {
+        return this->position.at(y, x);
+    }
+    const PonderStats &getPonderStats() const { return this->ponder_stats; }
+    const WinCheckStats &getWinCheckStats() const {
+        return this->win_check_stats;
+    }
 };
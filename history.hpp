@@ -0,0 +1,46 @@
+#pragma once
+
+#include "position.hpp"
+
+// A played move along with the player who made it
+struct MoveRecord {
+    Move move;
+    Token player;
+};
+
+// Played moves which can be undone, followed by undone moves which can be
+// redone. Every game ends before the board holds more moves than cells, so
+// the stack has a fixed size.
+class MoveStack {
+   private:
+    MoveRecord records[CELL_COUNT];
+    unsigned int played = 0;
+    unsigned int recorded = 0;
+
+   public:
+    void clear() { this->played = this->recorded = 0; }
+    unsigned int size() const { return this->played; }
+    bool canUndo() const { return this->played > 0; }
+    bool canRedo() const { return this->played < this->recorded; }
+    const MoveRecord &at(unsigned int i) const { return this->records[i]; }
+
+    // Records a new move, dropping the moves which could be redone
+    void push(Move move, Token player) {
+        this->records[this->played++] = { move, player };
+        this->recorded = this->played;
+    }
+
+    // Reverts the last move in the position and returns its record
+    MoveRecord undo(Position *position) {
+        MoveRecord record = this->records[--this->played];
+        position->unmakeMove(record.move, record.player);
+        return record;
+    }
+
+    // Plays the last undone move again and returns its record
+    MoveRecord redo(Position *position) {
+        MoveRecord record = this->records[this->played++];
+        position->makeMove(record.move, record.player);
+        return record;
+    }
+};
@@ -1,9 +1,22 @@
+#include <cstring>
 #include <iostream>
 #include <string>
 
+#include "batch.hpp"
+#include "benchmark.hpp"
+#include "book.hpp"
 #include "game.hpp"
+#include "nnue.hpp"
+#include "perft.hpp"
+#include "protocol.hpp"
+#include "record.hpp"
+#include "selfplay.hpp"
+#include "tablebase.hpp"
 #include "util.hpp"
 
+// Depth searched by the thread scaling benchmark
+const unsigned int BENCH_SMP_DEPTH = 4;
+
 int chooseGameMode() {
     int input;
 
@@ -29,9 +42,297 @@ int chooseGameMode() {
     return input;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     srand(time(NULL));
 
+    // Command line options
+    unsigned int threads = 1;
+    bool selfplay = false;
+    bool protocol = false;
+    SelfPlayConfig selfplay_config;
+    unsigned int perft_depth = 0;
+    std::string position_name;
+    unsigned int board_size = BOARD_SIZE;
+    std::string tablebase_dir;
+    std::string tablebase_build_dir;
+    std::string tablebase_verify_path;
+    uint64_t tablebase_samples = 0;
+    std::string book_path;
+    std::string book_build_path;
+    unsigned int book_plies = BOOK_DEFAULT_PLIES;
+    unsigned int book_depth = BOOK_DEFAULT_DEPTH;
+    std::string record_path;
+    std::string replay_path;
+    int64_t replay_game = -1;
+    std::string analyze_path;
+    std::string network_path;
+    SearchLimits analyze_limits;
+    analyze_limits.depth = BATCH_DEFAULT_DEPTH;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if (std::strcmp(argv[i], "--threads") == 0 && has_value) {
+            threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--bench-smp") == 0 && has_value) {
+            runThreadBenchmark(std::atoi(argv[++i]), BENCH_SMP_DEPTH);
+            return 0;
+        } else if (std::strcmp(argv[i], "--selfplay") == 0 && has_value) {
+            selfplay = true;
+            selfplay_config.games = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--protocol") == 0) {
+            protocol = true;
+        } else if (std::strcmp(argv[i], "--perft") == 0 && has_value &&
+                   std::atoi(argv[i + 1]) > 0) {
+            perft_depth = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--position") == 0 && has_value) {
+            position_name = argv[++i];
+        } else if (std::strcmp(argv[i], "--board") == 0 && has_value) {
+            board_size = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--tablebase") == 0 && has_value) {
+            tablebase_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--tablebase-build") == 0 &&
+                   has_value) {
+            tablebase_build_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--tablebase-verify") == 0 &&
+                   has_value) {
+            tablebase_verify_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--samples") == 0 && has_value) {
+            tablebase_samples = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--book") == 0 && has_value) {
+            book_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--book-build") == 0 && has_value) {
+            book_build_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--book-plies") == 0 && has_value) {
+            book_plies = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--book-depth") == 0 && has_value &&
+                   std::atoi(argv[i + 1]) > 0) {
+            book_depth = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--record") == 0 && has_value) {
+            record_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay") == 0 && has_value) {
+            replay_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--game") == 0 && has_value &&
+                   std::atoll(argv[i + 1]) >= 0) {
+            replay_game = std::atoll(argv[++i]);
+        } else if (std::strcmp(argv[i], "--analyze-file") == 0 && has_value) {
+            analyze_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--analyze-depth") == 0 &&
+                   has_value && std::atoi(argv[i + 1]) > 0 &&
+                   std::atoi(argv[i + 1]) <= (int)MAX_DEPTH) {
+            analyze_limits.depth = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--analyze-ms") == 0 && has_value) {
+            analyze_limits.time_ms = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--nnue") == 0 && has_value) {
+            network_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--player1") == 0 && has_value &&
+                   parseAgent(argv[i + 1], &selfplay_config.agents[0]) == 0) {
+            i++;
+        } else if (std::strcmp(argv[i], "--player2") == 0 && has_value &&
+                   parseAgent(argv[i + 1], &selfplay_config.agents[1]) == 0) {
+            i++;
+        } else if (std::strcmp(argv[i], "--mode") == 0 && has_value &&
+                   (std::strcmp(argv[i + 1], "pentago") == 0 ||
+                    std::strcmp(argv[i + 1], "tictactoe") == 0)) {
+            selfplay_config.rotations = std::strcmp(argv[++i], "pentago") == 0;
+        } else if (std::strcmp(argv[i], "--seed") == 0 && has_value) {
+            selfplay_config.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--random-plies") == 0 && has_value) {
+            selfplay_config.random_plies = std::atoi(argv[++i]);
+        } else {
+            std::cout
+                << "Usage: " << argv[0] << " [options]" << std::endl
+                << "\t--threads N          search threads of computer "
+                   "players, or parallel self-play games"
+                << std::endl
+                << "\t--bench-smp N        thread scaling benchmark with 1..N "
+                   "threads"
+                << std::endl
+                << "\t--selfplay N         play N games without any output"
+                << std::endl
+                << "\t--player1 PLAYER     self-play player: random, greedy, "
+                   "engine:<depth> or mcts:<playouts>"
+                << std::endl
+                << "\t--player2 PLAYER" << std::endl
+                << "\t--mode MODE          self-play and perft game: "
+                   "pentago or tictactoe"
+                << std::endl
+                << "\t--seed N             self-play random seed" << std::endl
+                << "\t--random-plies N     random moves at the start of "
+                   "self-play games"
+                << std::endl
+                << "\t--protocol           line-based engine protocol on "
+                   "stdin and stdout"
+                << std::endl
+                << "\t--perft DEPTH        count the move sequences of the "
+                   "given length"
+                << std::endl
+                << "\t--position NAME      perft and tablebase root position: "
+                   "empty, midgame, example or endgame"
+                << std::endl
+                << "\t--board SIZE         perft board size: 6, 8 or 9, the "
+                   "larger ones start empty"
+                << std::endl
+                << "\t--tablebase DIR      probe the endgame tablebase in DIR "
+                   "during searches"
+                << std::endl
+                << "\t--tablebase-build DIR\n"
+                   "\t                     solve every position reachable "
+                   "from --position (endgame)"
+                << std::endl
+                << "\t--tablebase-verify FILE\n"
+                   "\t                     check a tablebase slice against "
+                   "plain search"
+                << std::endl
+                << "\t--samples N          slice records checked by "
+                   "--tablebase-verify, 0 for all"
+                << std::endl
+                << "\t--book FILE          answer opening positions from the "
+                   "book in FILE"
+                << std::endl
+                << "\t--book-build FILE    search the opening positions and "
+                   "write the book"
+                << std::endl
+                << "\t--book-plies N       plies covered by the built book"
+                << std::endl
+                << "\t--book-depth D       search depth of the built book"
+                << std::endl
+                << "\t--record FILE        append the played and self-play "
+                   "games to FILE"
+                << std::endl
+                << "\t--replay FILE        replay and check the recorded games"
+                << std::endl
+                << "\t--game N             print recorded game N instead"
+                << std::endl
+                << "\t--analyze-file FILE  search every position in FILE, "
+                   "text or game records"
+                << std::endl
+                << "\t--analyze-depth D    search depth of each position, "
+                   "default 4"
+                << std::endl
+                << "\t--analyze-ms MS      search time limit of each position"
+                << std::endl
+                << "\t--nnue FILE          evaluate with the network in FILE, "
+                   "see pentago_train"
+                << std::endl;
+            return 1;
+        }
+    }
+
+    // Perft starts from the empty board and the tablebase from the endgame,
+    // unless another position is given
+    if (position_name.empty()) {
+        position_name = perft_depth > 0 ? "empty" : "endgame";
+    }
+
+    std::vector<BenchmarkPosition> positions = benchmarkPositions();
+    const BenchmarkPosition *root = nullptr;
+    for (const BenchmarkPosition &bench : positions) {
+        if (position_name == bench.name) {
+            root = &bench;
+        }
+    }
+
+    if ((perft_depth > 0 || !tablebase_build_dir.empty()) && root == nullptr) {
+        std::cout << "Unknown position " << position_name << std::endl;
+        return 1;
+    }
+
+    if (!tablebase_build_dir.empty()) {
+        return buildTablebase(root->position, root->player,
+                              selfplay_config.rotations, tablebase_build_dir,
+                              threads)
+                   ? 0
+                   : 1;
+    }
+
+    if (!tablebase_verify_path.empty()) {
+        return verifyTablebaseSlice(tablebase_verify_path, tablebase_samples,
+                                    threads)
+                   ? 0
+                   : 1;
+    }
+
+    if (perft_depth > 0 && board_size != BOARD_SIZE) {
+        if (position_name != "empty" ||
+            !runBoardPerft(board_size, selfplay_config.rotations, perft_depth,
+                           threads)) {
+            std::cout << "Unsupported board " << board_size << " with position "
+                      << position_name << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (perft_depth > 0) {
+        runPerft(root->position, root->player, selfplay_config.rotations,
+                 perft_depth, threads);
+        return 0;
+    }
+
+    if (!replay_path.empty()) {
+        bool valid = replay_game >= 0
+                         ? printRecordedGame(replay_path, replay_game)
+                         : replayGameFile(replay_path);
+        return valid ? 0 : 1;
+    }
+
+    if (!book_build_path.empty()) {
+        return buildBook(book_build_path, book_plies, book_depth,
+                         selfplay_config.rotations, threads)
+                   ? 0
+                   : 1;
+    }
+
+    OpeningBook book;
+    if (!book_path.empty() && !book.open(book_path)) {
+        std::cout << "Can't open the book " << book_path << std::endl;
+        return 1;
+    }
+    const OpeningBook *opening = book_path.empty() ? nullptr : &book;
+
+    Tablebase tablebase;
+    if (!tablebase_dir.empty() && tablebase.open(tablebase_dir) == 0) {
+        std::cout << "No tablebase slices in " << tablebase_dir << std::endl;
+        return 1;
+    }
+    const Tablebase *probed = tablebase_dir.empty() ? nullptr : &tablebase;
+
+    Network loaded;
+    if (!network_path.empty() && !loaded.load(network_path)) {
+        std::cout << "Can't load the network " << network_path << std::endl;
+        return 1;
+    }
+    const Network *network = network_path.empty() ? nullptr : &loaded;
+
+    if (protocol) {
+        return runProtocol(threads, probed, opening, network);
+    }
+
+    if (!analyze_path.empty()) {
+        return analyzeFile(analyze_path, analyze_limits,
+                           selfplay_config.rotations, threads, probed,
+                           network)
+                   ? 0
+                   : 1;
+    }
+
+    GameRecordWriter records;
+    if (!record_path.empty() && !records.open(record_path)) {
+        std::cout << "Can't append game records to " << record_path
+                  << std::endl;
+        return 1;
+    }
+    if (!record_path.empty()) {
+        selfplay_config.records = &records;
+    }
+
+    if (selfplay) {
+        selfplay_config.threads = threads;
+        printSelfPlayStats(selfplay_config, runSelfPlay(selfplay_config));
+        return 0;
+    }
+
     // Needed in order for clearScreen and box drawings to work
     system("chcp 65001 >nul");
 
@@ -47,6 +348,11 @@ int main() {
     }
 
     Game game = Game(title);
+    game.setEngineThreads(threads);
+    game.setTablebase(probed);
+    game.setNetwork(network);
+    game.setBook(opening);
+    game.setRecords(selfplay_config.records);
 
     // Player name and symbol choices
     for (int i = Token::Player1; i <= Token::Player2; i++) {
@@ -74,6 +380,20 @@ int main() {
             }
         }
 
+        while (true) {
+            std::string control;
+            std::cout << "Player " << i + 1
+                      << " controlled by (1 - human, 2 - computer, "
+                         "3 - computer (MCTS)): ";
+            std::cin >> control;
+            if (control == "1" || control == "2" || control == "3") {
+                game.setPlayerControl((Token)i,
+                                      (PlayerControl)(control[0] - '1'));
+                break;
+            }
+            std::cout << "Choose 1, 2 or 3." << std::endl;
+        }
+
         std::cout << std::endl;
     }
 
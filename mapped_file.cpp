@@ -0,0 +1,58 @@
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+MappedFile::MappedFile(MappedFile &&other) {
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) {
+    if (this != &other) {
+        this->close();
+        std::swap(this->bytes, other.bytes);
+        std::swap(this->length, other.length);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string &path) {
+    this->close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // The mapping stays valid after closing the descriptor
+    void *mapped =
+        mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    this->bytes = (const uint8_t *)mapped;
+    this->length = info.st_size;
+
+    return true;
+}
+
+void MappedFile::close() {
+    if (this->bytes != nullptr) {
+        munmap((void *)this->bytes, this->length);
+        this->bytes = nullptr;
+        this->length = 0;
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a whole file mapped into memory. Opening only sets up
+// the mapping, the pages are read by the OS when they are first touched and
+// are shared with every other process mapping the same file.
+class MappedFile {
+   private:
+    const uint8_t *bytes = nullptr;
+    size_t length = 0;
+
+   public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other);
+    MappedFile &operator=(MappedFile &&other);
+    ~MappedFile() { this->close(); }
+
+    // Returns false if the file can't be opened or mapped
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const { return this->bytes != nullptr; }
+    const uint8_t *data() const { return this->bytes; }
+    size_t size() const { return this->length; }
+};
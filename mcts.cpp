@@ -0,0 +1,419 @@
+#include "mcts.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "movegen.hpp"
+#include "search.hpp"
+
+// Exploration constant of UCT
+const double MCTS_EXPLORATION = 1.4;
+// Visits a leaf needs before its children get allocated. Every expansion
+// allocates all of them at once, so this keeps the arena from filling up with
+// children of nodes which are rarely visited again.
+const uint32_t MCTS_EXPAND_VISITS = 16;
+// Playouts between checks of the clock
+const uint64_t MCTS_TIME_CHECK_INTERVAL = 256;
+// Playouts of a search without any limits
+const uint64_t MCTS_DEFAULT_PLAYOUTS = 10000;
+const uint32_t NO_NODE = UINT32_MAX;
+
+void resetNode(MctsNode *node, Move move) {
+    node->visits.store(0, std::memory_order_relaxed);
+    node->points.store(0, std::memory_order_relaxed);
+    node->virtual_losses.store(0, std::memory_order_relaxed);
+    node->first_child = 0;
+    node->child_count = 0;
+    node->move = move;
+    node->state.store(MctsNodeState::Unexpanded, std::memory_order_relaxed);
+}
+
+void copyNode(MctsNode *to, const MctsNode &from) {
+    to->visits.store(from.visits.load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+    to->points.store(from.points.load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+    to->virtual_losses.store(0, std::memory_order_relaxed);
+    to->first_child = from.first_child;
+    to->child_count = from.child_count;
+    to->move = from.move;
+
+    // Nodes which were being expanded when the search stopped start over
+    uint8_t state = from.state.load(std::memory_order_relaxed);
+    to->state.store(state == MctsNodeState::Expanded
+                        ? MctsNodeState::Expanded
+                        : MctsNodeState::Unexpanded,
+                    std::memory_order_relaxed);
+}
+
+// Points of a finished game for the player who made a node's move
+uint32_t pointsFor(Token mover, Token winner) {
+    if (winner == Token::Empty) {
+        return 1;
+    }
+    return winner == mover ? 2 : 0;
+}
+
+// Winner of a finished game by its `winners` result, Token::Empty for draws
+Token winnerOf(unsigned int result) {
+    if (result == WINNER_PLAYER1) {
+        return Token::Player1;
+    } else if (result == WINNER_PLAYER2) {
+        return Token::Player2;
+    }
+    return Token::Empty;
+}
+
+MctsEngine::MctsEngine(uint32_t nodes) {
+    this->arena.reset(new MctsNode[nodes]);
+    this->spare.reset(new MctsNode[nodes]);
+    this->capacity = nodes;
+    this->used = 0;
+    this->threads = 1;
+    this->has_tree = false;
+    this->rotations = true;
+    this->playouts = 0;
+    this->stopped = false;
+    this->searches = 0;
+}
+
+void MctsEngine::setThreads(unsigned int threads) {
+    this->threads = std::clamp(threads, 1u, MAX_THREADS);
+}
+
+unsigned int MctsEngine::elapsedMs() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - this->start)
+        .count();
+}
+
+// Reserves `count` consecutive nodes, failing when the arena is full
+bool MctsEngine::allocate(uint32_t count, uint32_t *first) {
+    uint32_t used = this->used.load(std::memory_order_relaxed);
+
+    do {
+        if (this->capacity - used < count) {
+            return false;
+        }
+    } while (!this->used.compare_exchange_weak(used, used + count,
+                                               std::memory_order_relaxed));
+
+    *first = used;
+    return true;
+}
+
+// Allocates the children of a node, one for every distinct move
+bool MctsEngine::expand(MctsNode *node, const Position &position,
+                        Token player) {
+    MoveList list;
+    generateMoves(position, player, this->rotations, &list);
+
+    uint32_t first;
+    if (!this->allocate(list.count, &first)) {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < list.count; i++) {
+        resetNode(&this->arena[first + i], list.moves[i]);
+    }
+
+    node->first_child = first;
+    node->child_count = list.count;
+    node->state.store(MctsNodeState::Expanded, std::memory_order_release);
+
+    return true;
+}
+
+// Picks the child with the highest UCT value, counting virtual losses as
+// visits without any points
+uint32_t MctsEngine::select(const MctsNode &node) const {
+    uint32_t parent = node.visits.load(std::memory_order_relaxed) +
+                      node.virtual_losses.load(std::memory_order_relaxed);
+    double log_parent = std::log(std::max(parent, 1u));
+
+    uint32_t best = 0;
+    double best_value = -1;
+
+    for (uint32_t i = 0; i < node.child_count; i++) {
+        const MctsNode &child = this->arena[node.first_child + i];
+        uint32_t visits =
+            child.visits.load(std::memory_order_relaxed) +
+            child.virtual_losses.load(std::memory_order_relaxed);
+
+        if (visits == 0) {
+            return i;
+        }
+
+        double value =
+            child.points.load(std::memory_order_relaxed) / (2.0 * visits) +
+            MCTS_EXPLORATION * std::sqrt(log_parent / visits);
+
+        if (value > best_value) {
+            best_value = value;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+// Runs a single iteration: selects a path down the tree, expanding its last
+// node when it was visited often enough, plays the game out at random from
+// there and records the result along the path
+void MctsEngine::playout(Rng *rng) {
+    Position position = this->root_position;
+    Token player = this->root_player;
+
+    uint32_t path[CELL_COUNT + 1];
+    unsigned int length = 0;
+    path[length++] = 0;
+
+    MctsNode *node = &this->arena[0];
+    Token winner = Token::Empty;
+    bool finished = false;
+
+    while (true) {
+        uint8_t state = node->state.load(std::memory_order_acquire);
+
+        if (state == MctsNodeState::Unexpanded &&
+            node->visits.load(std::memory_order_relaxed) >=
+                MCTS_EXPAND_VISITS &&
+            node->state.compare_exchange_strong(state,
+                                                MctsNodeState::Expanding)) {
+            // A full arena leaves the node as a leaf for good
+            this->expand(node, position, player);
+            state = node->state.load(std::memory_order_acquire);
+        }
+
+        if (state != MctsNodeState::Expanded) {
+            break;
+        }
+
+        uint32_t index = node->first_child + this->select(*node);
+        MctsNode *child = &this->arena[index];
+        child->virtual_losses.fetch_add(1, std::memory_order_relaxed);
+        path[length++] = index;
+
+        position.makeMove(child->move, player);
+
+        unsigned int result = winnersAfterMove(position, child->move);
+        if (result != 0 || position.full()) {
+            winner = winnerOf(result);
+            finished = true;
+            break;
+        }
+
+        player = otherPlayer(player);
+        node = child;
+    }
+
+    // Random playout from the leaf
+    while (!finished) {
+        Move move = randomMove(position, this->rotations, rng);
+        position.makeMove(move, player);
+
+        unsigned int result = winnersAfterMove(position, move);
+        if (result != 0 || position.full()) {
+            winner = winnerOf(result);
+            finished = true;
+        }
+
+        player = otherPlayer(player);
+    }
+
+    // The root's move was made by the opponent of the player to move
+    Token mover = otherPlayer(this->root_player);
+    for (unsigned int i = 0; i < length; i++) {
+        MctsNode &visited = this->arena[path[i]];
+        visited.visits.fetch_add(1, std::memory_order_relaxed);
+        visited.points.fetch_add(pointsFor(mover, winner),
+                                 std::memory_order_relaxed);
+        if (i > 0) {
+            visited.virtual_losses.fetch_sub(1, std::memory_order_relaxed);
+        }
+        mover = otherPlayer(mover);
+    }
+}
+
+void MctsEngine::work(unsigned int id) {
+    Rng rng(ZOBRIST_SEED ^ (this->searches << 16) ^ id);
+
+    while (!this->stopped.load(std::memory_order_relaxed)) {
+        this->playout(&rng);
+        uint64_t done =
+            this->playouts.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        if (this->limits.playouts != 0 && done >= this->limits.playouts) {
+            this->stopped = true;
+        }
+
+        if (this->limits.time_ms != 0 &&
+            done % MCTS_TIME_CHECK_INTERVAL == 0 &&
+            this->elapsedMs() >= this->limits.time_ms) {
+            this->stopped = true;
+        }
+    }
+}
+
+// Finds the node of the position in the current tree, looking at most two
+// moves deep from the root
+uint32_t MctsEngine::findRoot(const Position &position, Token player) {
+    const MctsNode &root = this->arena[0];
+
+    if (samePosition(position, this->root_position) &&
+        player == this->root_player) {
+        return 0;
+    }
+
+    if (root.state.load() != MctsNodeState::Expanded) {
+        return NO_NODE;
+    }
+
+    Token opponent = otherPlayer(this->root_player);
+
+    for (uint32_t i = 0; i < root.child_count; i++) {
+        const MctsNode &child = this->arena[root.first_child + i];
+        Position after_child = this->root_position;
+        after_child.makeMove(child.move, this->root_player);
+
+        if (player == opponent && samePosition(position, after_child)) {
+            return root.first_child + i;
+        }
+
+        if (player != this->root_player ||
+            child.state.load() != MctsNodeState::Expanded) {
+            continue;
+        }
+
+        for (uint32_t j = 0; j < child.child_count; j++) {
+            const MctsNode &grandchild = this->arena[child.first_child + j];
+            Position after_grandchild = after_child;
+            after_grandchild.makeMove(grandchild.move, opponent);
+
+            if (samePosition(position, after_grandchild)) {
+                return child.first_child + j;
+            }
+        }
+    }
+
+    return NO_NODE;
+}
+
+// Copies the subtree of a node into the spare arena in breadth-first order,
+// which keeps the children of every node together, and swaps the arenas.
+// Returns the amount of nodes kept.
+uint32_t MctsEngine::compact(uint32_t root) {
+    MctsNode *to = this->spare.get();
+    copyNode(&to[0], this->arena[root]);
+    uint32_t count = 1;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (to[i].state.load() != MctsNodeState::Expanded) {
+            continue;
+        }
+
+        uint32_t first = to[i].first_child;
+        to[i].first_child = count;
+
+        for (uint32_t j = 0; j < to[i].child_count; j++) {
+            copyNode(&to[count++], this->arena[first + j]);
+        }
+    }
+
+    std::swap(this->arena, this->spare);
+    this->used = count;
+
+    return count;
+}
+
+MctsResult MctsEngine::search(const Position &position, Token player,
+                              bool rotations, const MctsLimits &limits) {
+    this->start = std::chrono::steady_clock::now();
+    this->limits = limits;
+    this->playouts = 0;
+    this->stopped = false;
+    this->searches++;
+
+    if (this->limits.playouts == 0 && this->limits.time_ms == 0) {
+        this->limits.playouts = MCTS_DEFAULT_PLAYOUTS;
+    }
+
+    MctsResult result = {};
+    uint32_t previous = this->used;
+    uint32_t root = NO_NODE;
+
+    if (this->has_tree && rotations == this->rotations) {
+        root = this->findRoot(position, player);
+    }
+
+    if (root != NO_NODE) {
+        result.reused_nodes = this->compact(root);
+        result.reuse_ratio = (double)result.reused_nodes / previous;
+    } else {
+        resetNode(&this->arena[0], { 0, NO_ROTATION });
+        this->used = 1;
+    }
+
+    this->rotations = rotations;
+    this->root_position = position;
+    this->root_player = player;
+    this->has_tree = true;
+
+    MctsNode &root_node = this->arena[0];
+    if (root_node.state.load() != MctsNodeState::Expanded) {
+        root_node.state = MctsNodeState::Expanding;
+
+        bool expanded = this->expand(&root_node, position, player);
+        if (!expanded && this->used > 1) {
+            // The kept tree leaves no room for the root's children
+            resetNode(&root_node, { 0, NO_ROTATION });
+            root_node.state = MctsNodeState::Expanding;
+            this->used = 1;
+            result.reused_nodes = 0;
+            result.reuse_ratio = 0;
+            expanded = this->expand(&root_node, position, player);
+        }
+
+        // The arena can't even hold the root's children
+        if (!expanded) {
+            Rng rng(ZOBRIST_SEED ^ (this->searches << 16));
+            this->has_tree = false;
+            result.best_move = randomMove(position, rotations, &rng);
+            result.time_ms = this->elapsedMs();
+            return result;
+        }
+    }
+
+    std::vector<std::thread> helpers;
+    for (unsigned int i = 1; i < this->threads; i++) {
+        helpers.emplace_back(&MctsEngine::work, this, i);
+    }
+
+    this->work(0);
+
+    for (std::thread &helper : helpers) {
+        helper.join();
+    }
+
+    // The most visited move is the most reliable one
+    uint32_t best = root_node.first_child;
+    for (uint32_t i = 0; i < root_node.child_count; i++) {
+        uint32_t index = root_node.first_child + i;
+        if (this->arena[index].visits > this->arena[best].visits) {
+            best = index;
+        }
+    }
+
+    const MctsNode &best_node = this->arena[best];
+    result.best_move = best_node.move;
+    result.win_rate =
+        best_node.visits ? best_node.points / (2.0 * best_node.visits) : 0;
+    result.playouts = this->playouts;
+    result.time_ms = this->elapsedMs();
+    result.tree_nodes = this->used;
+    result.arena_bytes = (uint64_t)this->used * sizeof(MctsNode);
+
+    return result;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "position.hpp"
+#include "util.hpp"
+
+// Default amount of tree nodes in the arena
+const uint32_t MCTS_DEFAULT_NODES = 1 << 20;
+
+enum MctsNodeState {
+    Unexpanded = 0,
+    Expanding = 1,
+    Expanded = 2,
+};
+
+// Tree node, stored in a contiguous arena with the children of a node next
+// to each other. Results are counted for the player who made the node's
+// move, in half points: 2 for a win and 1 for a draw.
+struct MctsNode {
+    std::atomic<uint32_t> visits;
+    std::atomic<uint32_t> points;
+    std::atomic<uint32_t> virtual_losses;
+    uint32_t first_child;
+    uint16_t child_count;
+    Move move;
+    std::atomic<uint8_t> state;  // MctsNodeState
+};
+
+struct MctsLimits {
+    uint64_t playouts = 0;     // 0 - no playout limit
+    unsigned int time_ms = 0;  // 0 - no time limit
+};
+
+struct MctsResult {
+    Move best_move;
+    double win_rate;  // Of the best move, for the player to move
+    uint64_t playouts;
+    unsigned int time_ms;
+    uint64_t tree_nodes;
+    uint64_t arena_bytes;  // Memory used by the tree nodes
+    uint64_t reused_nodes;  // Nodes kept from the previous search
+    double reuse_ratio;     // Share of the previous tree which was kept
+};
+
+// Monte Carlo Tree Search with UCT selection and random playouts, running
+// on multiple threads over a single shared tree. Threads add a virtual loss
+// to every node on their path until the playout result is in, which steers
+// other threads towards different paths.
+//
+// The tree is kept between searches. When the next search starts from a
+// position reached by a move or two from the previous root, the matching
+// subtree is compacted into the other half of a double buffered arena and
+// used as the new tree.
+class MctsEngine {
+   private:
+    std::unique_ptr<MctsNode[]> arena;
+    std::unique_ptr<MctsNode[]> spare;
+    uint32_t capacity;
+    std::atomic<uint32_t> used;
+    unsigned int threads;
+    bool has_tree;
+    Position root_position;
+    Token root_player;
+    bool rotations;
+    MctsLimits limits;
+    std::chrono::steady_clock::time_point start;
+    std::atomic<uint64_t> playouts;
+    std::atomic<bool> stopped;
+    uint64_t searches;
+
+    uint32_t findRoot(const Position &position, Token player);
+    uint32_t compact(uint32_t root);
+    bool allocate(uint32_t count, uint32_t *first);
+    bool expand(MctsNode *node, const Position &position, Token player);
+    uint32_t select(const MctsNode &node) const;
+    void playout(Rng *rng);
+    void work(unsigned int id);
+    unsigned int elapsedMs() const;
+
+   public:
+    MctsEngine(uint32_t nodes = MCTS_DEFAULT_NODES);
+    MctsResult search(const Position &position, Token player,
+                      bool rotations, const MctsLimits &limits);
+    void setThreads(unsigned int threads);
+    // Forgets the tree, and restarts the random playouts from their first
+    // seed
+    void clear() {
+        this->has_tree = false;
+        this->searches = 0;
+    }
+};
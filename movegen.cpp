@@ -0,0 +1,147 @@
+#include "movegen.hpp"
+
+#include "symmetry.hpp"
+
+// Hash set of the positions generated for a single move list. Slots are
+// stamped with the list they belong to, so it never has to be cleared.
+const unsigned int SEEN_SLOTS = 1024;
+static_assert(SEEN_SLOTS > MAX_MOVES && (SEEN_SLOTS & (SEEN_SLOTS - 1)) == 0);
+
+struct SeenSet {
+    Bitboard tokens[SEEN_SLOTS][2];
+    uint64_t keys[SEEN_SLOTS];
+    uint32_t stamps[SEEN_SLOTS];
+    uint32_t stamp;
+
+    void reset() {
+        if (++this->stamp == 0) {
+            for (unsigned int i = 0; i < SEEN_SLOTS; i++) {
+                this->stamps[i] = 0;
+            }
+            this->stamp = 1;
+        }
+    }
+
+    // Adds a position under the given key, false if it was already there
+    bool insert(const Position &position, uint64_t key) {
+        unsigned int slot = key & (SEEN_SLOTS - 1);
+
+        while (this->stamps[slot] == this->stamp) {
+            if (this->keys[slot] == key &&
+                this->tokens[slot][Player1] == position.tokens[Player1] &&
+                this->tokens[slot][Player2] == position.tokens[Player2]) {
+                return false;
+            }
+            slot = (slot + 1) & (SEEN_SLOTS - 1);
+        }
+
+        this->stamps[slot] = this->stamp;
+        this->keys[slot] = key;
+        this->tokens[slot][Player1] = position.tokens[Player1];
+        this->tokens[slot][Player2] = position.tokens[Player2];
+
+        return true;
+    }
+};
+
+thread_local SeenSet seen = {};
+
+// Adds the move to the list unless its result was already seen
+void addIfNew(const Position &child, Move move, bool symmetric,
+              MoveList *list) {
+    uint64_t key = child.key;
+    Position stored = child;
+
+    if (symmetric) {
+        unsigned int symmetry;
+        key = canonicalKey(child, &symmetry);
+        stored = transformPosition(child, symmetry);
+    }
+
+    if (seen.insert(stored, key)) {
+        list->moves[list->count++] = move;
+    }
+}
+
+// Generates the moves, keeping only the first of any moves which lead to the
+// same position. Rotating is optional, so with `rotations` set every
+// placement comes with all 8 rotations after the plain placement. With
+// `symmetric` set, moves leading to mirrored or rotated copies of an earlier
+// result are removed as well.
+void generate(const Position &position, Token player, bool rotations,
+              bool symmetric, MoveList *list) {
+    Bitboard empty = ~position.occupied() & BOARD_MASK;
+    list->count = 0;
+    list->raw_count = 0;
+
+    // Different placements can't lead to the same position without rotations
+    if (!rotations && !symmetric) {
+        while (empty) {
+            list->moves[list->count++] = { (uint8_t)__builtin_ctzll(empty),
+                                           NO_ROTATION };
+            empty &= empty - 1;
+        }
+        list->raw_count = list->count;
+        return;
+    }
+
+    seen.reset();
+
+    while (empty) {
+        uint8_t cell = __builtin_ctzll(empty);
+        empty &= empty - 1;
+
+        Position placed = position;
+        placed.place(cell, player);
+        list->raw_count++;
+        addIfNew(placed, { cell, NO_ROTATION }, symmetric, list);
+
+        if (!rotations) {
+            continue;
+        }
+
+        for (uint8_t rotation = 0; rotation < NO_ROTATION; rotation++) {
+            Position child = placed;
+            child.rotateQuad(rotation / 2, (Rotation)(rotation % 2));
+            list->raw_count++;
+
+            // Rotating an empty or rotationally symmetric quad changes
+            // nothing, which is caught here without touching the hash set
+            if (child.tokens[Player1] == placed.tokens[Player1] &&
+                child.tokens[Player2] == placed.tokens[Player2]) {
+                continue;
+            }
+
+            addIfNew(child, { cell, rotation }, symmetric, list);
+        }
+    }
+}
+
+// Generates the moves leading to distinct positions
+void generateMoves(const Position &position, Token player, bool rotations,
+                   MoveList *list) {
+    generate(position, player, rotations, false, list);
+}
+
+// Generates the moves leading to distinct positions up to board symmetry. Only
+// one move of every group of equivalent ones is kept, which is enough at the
+// root of a search.
+void generateRootMoves(const Position &position, Token player, bool rotations,
+                       MoveList *list) {
+    generate(position, player, rotations, true, list);
+}
+
+// Uniformly random placement, followed by no rotation or a random one
+Move randomMove(const Position &position, bool rotations, Rng *rng) {
+    Bitboard empty = ~position.occupied() & BOARD_MASK;
+
+    for (unsigned int skip = rng->below(__builtin_popcountll(empty)); skip > 0;
+         skip--) {
+        empty &= empty - 1;
+    }
+
+    uint8_t rotation =
+        rotations ? rng->below(NO_ROTATION + 1) : NO_ROTATION;
+
+    return { (uint8_t)__builtin_ctzll(empty), rotation };
+}
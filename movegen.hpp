@@ -0,0 +1,19 @@
+#pragma once
+
+#include "position.hpp"
+#include "util.hpp"
+
+// Every placement combined with no rotation or any of the 8 rotations
+const unsigned int MAX_MOVES = CELL_COUNT * (NO_ROTATION + 1);
+
+struct MoveList {
+    Move moves[MAX_MOVES];
+    unsigned int count;
+    unsigned int raw_count;  // Legal moves before removing duplicates
+};
+
+void generateMoves(const Position &position, Token player, bool rotations,
+                   MoveList *list);
+void generateRootMoves(const Position &position, Token player, bool rotations,
+                       MoveList *list);
+Move randomMove(const Position &position, bool rotations, Rng *rng);
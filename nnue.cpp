@@ -0,0 +1,239 @@
+#include "nnue.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "eval.hpp"
+
+// Plain loops over the fixed-size arrays below are vectorized by the
+// compiler for the baseline instruction set. The dense layer also has an
+// AVX2 version, chosen at runtime like the batched evaluation's.
+
+bool saveNetwork(const std::string &path, const NnueWeights &weights) {
+    NnueHeader header = {};
+    std::memcpy(header.magic, NNUE_MAGIC, sizeof(header.magic));
+    header.version = NNUE_VERSION;
+    header.features = NNUE_FEATURES;
+    header.hidden = NNUE_HIDDEN;
+    header.hidden2 = NNUE_HIDDEN2;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write((const char *)&header, sizeof(header));
+    out.write((const char *)&weights, sizeof(weights));
+
+    return (bool)out;
+}
+
+bool Network::load(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    NnueHeader header;
+
+    if (!in.read((char *)&header, sizeof(header)) ||
+        std::memcmp(header.magic, NNUE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != NNUE_VERSION || header.features != NNUE_FEATURES ||
+        header.hidden != NNUE_HIDDEN || header.hidden2 != NNUE_HIDDEN2) {
+        return false;
+    }
+
+    NnueWeights weights;
+    if (!in.read((char *)&weights, sizeof(weights)) || in.peek() != EOF) {
+        return false;
+    }
+
+    this->weights = weights;
+
+    return true;
+}
+
+void Network::addToken(unsigned int cell, Token token,
+                       Accumulator *acc) const {
+    for (unsigned int view = Token::Player1; view <= Token::Player2; view++) {
+        const int16_t *row =
+            this->weights.feature_weights[cell +
+                                          (token == view ? 0 : CELL_COUNT)];
+        for (unsigned int i = 0; i < NNUE_HIDDEN; i++) {
+            acc->values[view][i] += row[i];
+        }
+    }
+}
+
+void Network::removeToken(unsigned int cell, Token token,
+                          Accumulator *acc) const {
+    for (unsigned int view = Token::Player1; view <= Token::Player2; view++) {
+        const int16_t *row =
+            this->weights.feature_weights[cell +
+                                          (token == view ? 0 : CELL_COUNT)];
+        for (unsigned int i = 0; i < NNUE_HIDDEN; i++) {
+            acc->values[view][i] -= row[i];
+        }
+    }
+}
+
+void Network::refresh(const Position &position, Accumulator *acc) const {
+    for (unsigned int view = Token::Player1; view <= Token::Player2; view++) {
+        std::memcpy(acc->values[view], this->weights.feature_biases,
+                    sizeof(acc->values[view]));
+    }
+
+    for (unsigned int p = Token::Player1; p <= Token::Player2; p++) {
+        for (Bitboard tokens = position.tokens[p]; tokens != 0;
+             tokens &= tokens - 1) {
+            this->addToken(lowestBit(tokens), (Token)p, acc);
+        }
+    }
+}
+
+void Network::update(const Accumulator &parent, const Position &after,
+                     Move move, Token player, Accumulator *child) const {
+    *child = parent;
+    this->addToken(move.cell, player, child);
+
+    if (move.rotation == NO_ROTATION) {
+        return;
+    }
+
+    // Only the cells of the rotated quad whose token changed are updated,
+    // comparing the quad with its contents before the rotation
+    unsigned int quad = move.rotation / 2;
+    Position before = after;
+    before.rotateQuad(quad, (Rotation)((move.rotation % 2) ^ 1));
+
+    for (unsigned int p = Token::Player1; p <= Token::Player2; p++) {
+        Bitboard changed =
+            (before.tokens[p] ^ after.tokens[p]) & QUAD_MASKS[quad];
+
+        for (Bitboard cells = changed & before.tokens[p]; cells != 0;
+             cells &= cells - 1) {
+            this->removeToken(lowestBit(cells), (Token)p, child);
+        }
+        for (Bitboard cells = changed & after.tokens[p]; cells != 0;
+             cells &= cells - 1) {
+            this->addToken(lowestBit(cells), (Token)p, child);
+        }
+    }
+}
+
+// Output of the layers after the accumulators, `us` being the side to
+// move's accumulator
+int32_t propagate(const NnueWeights &weights, const int16_t *us,
+                  const int16_t *them) {
+    // Clipped first layer outputs, side to move first
+    int16_t inputs[2 * NNUE_HIDDEN];
+    for (unsigned int i = 0; i < NNUE_HIDDEN; i++) {
+        inputs[i] = std::clamp<int16_t>(us[i], 0, NNUE_ACTIVATION_MAX);
+        inputs[NNUE_HIDDEN + i] =
+            std::clamp<int16_t>(them[i], 0, NNUE_ACTIVATION_MAX);
+    }
+
+    int32_t output = weights.output_bias;
+    for (unsigned int o = 0; o < NNUE_HIDDEN2; o++) {
+        int32_t sum = weights.hidden_biases[o];
+        for (unsigned int i = 0; i < 2 * NNUE_HIDDEN; i++) {
+            sum += inputs[i] * weights.hidden_weights[o][i];
+        }
+
+        int32_t hidden =
+            std::clamp(sum / NNUE_WEIGHT_SCALE, 0, NNUE_ACTIVATION_MAX);
+        output += hidden * weights.output_weights[o];
+    }
+
+    return output;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+static_assert(NNUE_HIDDEN == 32 && NNUE_HIDDEN2 == 8);
+
+// Clips 32 accumulator values to bytes, keeping their order
+__attribute__((target("avx2"))) inline __m256i clipToBytes(
+    const int16_t *values) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(NNUE_ACTIVATION_MAX);
+    __m256i low = _mm256_min_epi16(
+        _mm256_max_epi16(_mm256_load_si256((const __m256i *)values), zero),
+        max);
+    __m256i high = _mm256_min_epi16(
+        _mm256_max_epi16(
+            _mm256_load_si256((const __m256i *)(values + 16)), zero),
+        max);
+    // Packing interleaves the 128-bit halves
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xd8);
+}
+
+// Same as `propagate`, multiplying the byte inputs by the int8 weights.
+// Pairs of products stay below the int16 saturation as both factors are
+// within 127.
+__attribute__((target("avx2"))) int32_t propagateAvx2(
+    const NnueWeights &weights, const int16_t *us, const int16_t *them) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i inputs[2] = { clipToBytes(us), clipToBytes(them) };
+
+    __m256i sums[NNUE_HIDDEN2];
+    for (unsigned int o = 0; o < NNUE_HIDDEN2; o++) {
+        sums[o] = _mm256_setzero_si256();
+        for (unsigned int half = 0; half < 2; half++) {
+            __m256i row = _mm256_load_si256(
+                (const __m256i *)(weights.hidden_weights[o] +
+                                  half * NNUE_HIDDEN));
+            sums[o] = _mm256_add_epi32(
+                sums[o], _mm256_madd_epi16(
+                             _mm256_maddubs_epi16(inputs[half], row), ones));
+        }
+    }
+
+    // Horizontal sums of all outputs at once
+    __m256i s01 = _mm256_hadd_epi32(sums[0], sums[1]);
+    __m256i s23 = _mm256_hadd_epi32(sums[2], sums[3]);
+    __m256i s45 = _mm256_hadd_epi32(sums[4], sums[5]);
+    __m256i s67 = _mm256_hadd_epi32(sums[6], sums[7]);
+    __m256i s0123 = _mm256_hadd_epi32(s01, s23);
+    __m256i s4567 = _mm256_hadd_epi32(s45, s67);
+    __m256i hidden = _mm256_add_epi32(
+        _mm256_permute2x128_si256(s0123, s4567, 0x20),
+        _mm256_permute2x128_si256(s0123, s4567, 0x31));
+
+    // Negative sums are clipped to 0 whichever way they are rounded
+    hidden = _mm256_add_epi32(
+        hidden, _mm256_loadu_si256((const __m256i *)weights.hidden_biases));
+    hidden = _mm256_min_epi32(
+        _mm256_max_epi32(_mm256_srai_epi32(hidden, 6), _mm256_setzero_si256()),
+        _mm256_set1_epi32(NNUE_ACTIVATION_MAX));
+    static_assert(NNUE_WEIGHT_SCALE == 1 << 6);
+
+    __m256i products = _mm256_mullo_epi32(
+        hidden, _mm256_cvtepi8_epi32(_mm_loadl_epi64(
+                    (const __m128i *)weights.output_weights)));
+    __m128i total = _mm_add_epi32(_mm256_castsi256_si128(products),
+                                  _mm256_extracti128_si256(products, 1));
+    total = _mm_hadd_epi32(total, total);
+    total = _mm_hadd_epi32(total, total);
+
+    return weights.output_bias + _mm_cvtsi128_si32(total);
+}
+
+#endif
+
+int Network::evaluate(const Accumulator &acc, Token player) const {
+    const int16_t *us = acc.values[player];
+    const int16_t *them = acc.values[otherPlayer(player)];
+
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool avx2 = evalPathSupported(EvalPath::Avx2Eval);
+    int32_t output = avx2 ? propagateAvx2(this->weights, us, them)
+                          : propagate(this->weights, us, them);
+#else
+    int32_t output = propagate(this->weights, us, them);
+#endif
+
+    return (int64_t)output * NNUE_SCORE_SCALE /
+           (NNUE_ACTIVATION_MAX * NNUE_WEIGHT_SCALE);
+}
+
+int Network::evaluate(const Position &position, Token player) const {
+    Accumulator acc;
+    this->refresh(position, &acc);
+    return this->evaluate(acc, player);
+}
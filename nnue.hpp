@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "position.hpp"
+
+// Small neural network evaluation, updated efficiently along the search.
+//
+// The inputs are one feature per cell and token owner, seen from each
+// player: feature `cell` for the player's own tokens and `CELL_COUNT + cell`
+// for the opponent's. The first layer's output for each point of view, the
+// accumulator, is the sum of the weights of the present features, so a
+// placed token adds one weight row and a rotation subtracts and adds the
+// rows of only the cells of its quad that changed. The side to move's
+// accumulator and the opponent's are clipped to [0, NNUE_ACTIVATION_MAX]
+// and go through a small dense layer to the output.
+//
+// Weights are quantized: int16 for the first layer, int8 for the others.
+// An activation of 1.0 is NNUE_ACTIVATION_MAX and a weight of 1.0 after the
+// first layer is NNUE_WEIGHT_SCALE. An output of 1.0 is a win probability
+// of sigmoid(1) and scores NNUE_SCORE_SCALE.
+
+const unsigned int NNUE_FEATURES = 2 * CELL_COUNT;
+// Accumulator size of each point of view
+const unsigned int NNUE_HIDDEN = 32;
+const unsigned int NNUE_HIDDEN2 = 8;
+const int NNUE_ACTIVATION_MAX = 127;
+const int NNUE_WEIGHT_SCALE = 64;
+const int NNUE_SCORE_SCALE = 256;
+
+const char NNUE_MAGIC[8] = { 'P', 'T', 'G', 'O', 'N', 'N', 'U', 'E' };
+const uint32_t NNUE_VERSION = 1;
+
+struct NnueHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t features;  // NNUE_FEATURES
+    uint32_t hidden;    // NNUE_HIDDEN
+    uint32_t hidden2;   // NNUE_HIDDEN2
+};
+
+static_assert(sizeof(NnueHeader) == 24);
+
+// The weights file holds a header followed by this structure
+struct NnueWeights {
+    alignas(32) int16_t feature_weights[NNUE_FEATURES][NNUE_HIDDEN];
+    alignas(32) int16_t feature_biases[NNUE_HIDDEN];
+    // Inputs: the side to move's accumulator, then the opponent's
+    alignas(32) int8_t hidden_weights[NNUE_HIDDEN2][2 * NNUE_HIDDEN];
+    int32_t hidden_biases[NNUE_HIDDEN2];
+    int8_t output_weights[NNUE_HIDDEN2];
+    int32_t output_bias;
+};
+
+// First layer outputs of a position, indexed by the point of view's Token
+struct Accumulator {
+    alignas(32) int16_t values[2][NNUE_HIDDEN];
+};
+
+// Writes the header and the weights, returning false on errors
+bool saveNetwork(const std::string &path, const NnueWeights &weights);
+
+class Network {
+   private:
+    NnueWeights weights;
+
+    void addToken(unsigned int cell, Token token, Accumulator *acc) const;
+    void removeToken(unsigned int cell, Token token,
+                     Accumulator *acc) const;
+
+   public:
+    // Returns false if the file can't be read or doesn't match the sizes
+    bool load(const std::string &path);
+    const NnueWeights &getWeights() const { return this->weights; }
+
+    // Computes the accumulator from all the tokens of the position
+    void refresh(const Position &position, Accumulator *acc) const;
+    // Derives the accumulator of the position after the move from the one
+    // before it, given the position after the move
+    void update(const Accumulator &parent, const Position &after, Move move,
+                Token player, Accumulator *child) const;
+    // Score for the player to move
+    int evaluate(const Accumulator &acc, Token player) const;
+    int evaluate(const Position &position, Token player) const;
+};
@@ -0,0 +1,78 @@
+#include "notation.hpp"
+
+#include <cstring>
+
+std::string formatMove(Move move) {
+    unsigned int y = move.cell / BOARD_SIZE;
+    unsigned int x = move.cell % BOARD_SIZE;
+
+    // Numpad fields start with 1 in the lower left corner
+    unsigned int field =
+        (QUAD_SIZE - 1 - y % QUAD_SIZE) * QUAD_SIZE + x % QUAD_SIZE + 1;
+
+    std::string out;
+    out += QUAD_KEYS[quadIndex(y, x)];
+    out += (char)('0' + field);
+
+    if (move.rotation != NO_ROTATION) {
+        out += QUAD_KEYS[move.rotation / 2];
+        out += ROTATION_KEYS[move.rotation % 2];
+    }
+
+    return out;
+}
+
+// Index of the key in the array, or -1 if it isn't there
+int keyIndex(const char *keys, unsigned int count, char key) {
+    const void *found = key != '\0' ? std::memchr(keys, key, count) : nullptr;
+    return found ? (const char *)found - keys : -1;
+}
+
+int parseMove(const std::string &text, bool rotations, Move *move) {
+    int quad = keyIndex(QUAD_KEYS, 4, text.c_str()[0]);
+    if (quad < 0) {
+        return MoveParseResult::InvalidQuad;
+    }
+
+    if (text.length() < 2) {
+        return MoveParseResult::MissingField;
+    }
+
+    int field = text[1] - '0';
+    if (field < 1 || field > 9) {
+        return MoveParseResult::InvalidField;
+    }
+
+    // Rotation input is checked before making any changes to the board in
+    // order to prevent accidental user input errors
+    Move parsed;
+    parsed.rotation = NO_ROTATION;
+
+    if (rotations && text.length() >= 3) {
+        int rotated = keyIndex(QUAD_KEYS, 4, text[2]);
+        if (rotated < 0) {
+            return MoveParseResult::InvalidRotation;
+        }
+
+        if (text.length() < 4) {
+            return MoveParseResult::MissingDirection;
+        }
+
+        int direction = keyIndex(ROTATION_KEYS, 2, text[3]);
+        if (direction < 0) {
+            return MoveParseResult::InvalidDirection;
+        }
+
+        parsed.rotation = rotationCode(rotated, (Rotation)direction);
+    }
+
+    unsigned int origin = quadOrigin(quad);
+    unsigned int y =
+        origin / BOARD_SIZE + (QUAD_SIZE - 1) - (field - 1) / QUAD_SIZE;
+    unsigned int x = origin % BOARD_SIZE + (field - 1) % QUAD_SIZE;
+    parsed.cell = cellIndex(y, x);
+
+    *move = parsed;
+
+    return MoveParseResult::MoveParsed;
+}
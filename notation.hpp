@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+#include "position.hpp"
+
+// Keys of the quads, as seen on the keyboard
+const char QUAD_KEYS[4] = { 'q', 'w', 'a', 's' };
+// Keys of the rotation directions, indexed by Rotation
+const char ROTATION_KEYS[2] = { 'z', 'x' };
+
+// Formats a move in the input notation: quad, numpad field and optionally
+// the rotated quad and direction, e.g. "q7wz"
+std::string formatMove(Move move);
+
+enum MoveParseResult {
+    MoveParsed = 0,
+    InvalidQuad = -1,        // Placement quad isn't one of QUAD_KEYS
+    MissingField = -2,
+    InvalidField = -3,       // Not a number between 1 and 9
+    InvalidRotation = -4,    // Rotated quad isn't one of QUAD_KEYS
+    MissingDirection = -5,
+    InvalidDirection = -6,
+};
+
+// Parses a move written by `formatMove`. The rotation is optional and
+// ignored when `rotations` is false. Returns a MoveParseResult.
+int parseMove(const std::string &text, bool rotations, Move *move);
@@ -0,0 +1,185 @@
+#include "perft.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "notation.hpp"
+
+template <class B>
+uint64_t perft(BasicPosition<B> *position, Token player, bool rotations,
+               unsigned int depth) {
+    typename B::Bitboard empty = ~position->occupied() & B::BOARD_MASK;
+    unsigned int move_rotations = rotations ? B::NO_ROTATION + 1 : 1;
+
+    if (depth == 0) {
+        return 1;
+    }
+
+    // The last moves are counted without playing them
+    if (depth == 1) {
+        return (uint64_t)bitCount(empty) * move_rotations;
+    }
+
+    uint64_t nodes = 0;
+
+    for (; empty != 0; empty &= empty - 1) {
+        uint8_t cell = lowestBit(empty);
+
+        for (unsigned int i = 0; i < move_rotations; i++) {
+            // Moves without a rotation come first
+            Move move = { cell, (uint8_t)(B::NO_ROTATION - i) };
+            position->makeMove(move, player);
+
+            if (winnersAfterMove(*position, move) == 0 && !position->full()) {
+                nodes += perft(position, otherPlayer(player), rotations,
+                               depth - 1);
+            }
+
+            position->unmakeMove(move, player);
+        }
+    }
+
+    return nodes;
+}
+
+// Counts the move sequences starting with each root move separately. Root
+// moves are claimed one at a time by the threads.
+template <class B>
+std::vector<PerftDivide> perftDivide(const BasicPosition<B> &position,
+                                     Token player, bool rotations,
+                                     unsigned int depth, unsigned int threads) {
+    std::vector<PerftDivide> divide;
+    unsigned int move_rotations = rotations ? B::NO_ROTATION + 1 : 1;
+
+    for (typename B::Bitboard empty = ~position.occupied() & B::BOARD_MASK;
+         empty != 0; empty &= empty - 1) {
+        for (unsigned int i = 0; i < move_rotations; i++) {
+            Move move = { (uint8_t)lowestBit(empty),
+                          (uint8_t)(B::NO_ROTATION - i) };
+            divide.push_back({ move, 0 });
+        }
+    }
+
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t index = next++; index < divide.size(); index = next++) {
+            Move move = divide[index].move;
+            BasicPosition<B> child = position;
+            child.makeMove(move, player);
+
+            if (depth <= 1) {
+                divide[index].nodes = 1;
+            } else if (winnersAfterMove(child, move) == 0 && !child.full()) {
+                divide[index].nodes =
+                    perft(&child, otherPlayer(player), rotations, depth - 1);
+            }
+        }
+    };
+
+    std::vector<std::thread> helpers;
+    for (unsigned int i = 1; i < threads; i++) {
+        helpers.emplace_back(work);
+    }
+
+    work();
+
+    for (std::thread &helper : helpers) {
+        helper.join();
+    }
+
+    return divide;
+}
+
+// Formats a root move of any board: the column letter and row number of the
+// cell, counted from the upper left corner, and optionally the rotated quad's
+// index and direction, e.g. "c4/2z". The standard board uses its usual
+// notation.
+template <class B>
+std::string formatDivideMove(Move move) {
+    if (std::is_same<B, Board6>::value) {
+        return formatMove(move);
+    }
+
+    std::string out;
+    out += (char)('a' + move.cell % B::SIZE);
+    out += std::to_string(move.cell / B::SIZE + 1);
+
+    if (move.rotation != B::NO_ROTATION) {
+        out += '/';
+        out += std::to_string(move.rotation / 2 + 1);
+        out += ROTATION_KEYS[move.rotation % 2];
+    }
+
+    return out;
+}
+
+// Prints the node count of every root move, followed by the total and the
+// node rate
+template <class B>
+void runPerft(const BasicPosition<B> &position, Token player, bool rotations,
+              unsigned int depth, unsigned int threads) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<PerftDivide> divide = perftDivide(
+        position, player, rotations, depth, std::max(threads, 1u));
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    uint64_t total = 0;
+    for (const PerftDivide &entry : divide) {
+        std::cout << std::left << std::setw(8) << formatDivideMove<B>(entry.move)
+                  << std::right << entry.nodes << std::endl;
+        total += entry.nodes;
+    }
+
+    std::cout << std::fixed << std::setprecision(3) << std::endl
+              << "depth: " << depth << std::endl
+              << "moves: " << divide.size() << std::endl
+              << "nodes: " << total << std::endl
+              << "time: " << seconds << " s" << std::endl
+              << "nodes/s: " << (uint64_t)(seconds > 0 ? total / seconds : 0)
+              << std::endl;
+}
+
+template <class B>
+void runEmptyPerft(bool rotations, unsigned int depth, unsigned int threads) {
+    BasicPosition<B> position;
+    position.clear();
+    runPerft(position, Token::Player1, rotations, depth, threads);
+}
+
+bool runBoardPerft(unsigned int board_size, bool rotations,
+                   unsigned int depth, unsigned int threads) {
+    switch (board_size) {
+        case Board6::SIZE:
+            runEmptyPerft<Board6>(rotations, depth, threads);
+            return true;
+        case Board8::SIZE:
+            runEmptyPerft<Board8>(rotations, depth, threads);
+            return true;
+        case Board9::SIZE:
+            runEmptyPerft<Board9>(rotations, depth, threads);
+            return true;
+    }
+
+    return false;
+}
+
+template uint64_t perft(BasicPosition<Board6> *position, Token player,
+                        bool rotations, unsigned int depth);
+template uint64_t perft(BasicPosition<Board8> *position, Token player,
+                        bool rotations, unsigned int depth);
+template uint64_t perft(BasicPosition<Board9> *position, Token player,
+                        bool rotations, unsigned int depth);
+template std::vector<PerftDivide> perftDivide(
+    const BasicPosition<Board6> &position, Token player, bool rotations,
+    unsigned int depth, unsigned int threads);
+template void runPerft(const BasicPosition<Board6> &position, Token player,
+                       bool rotations, unsigned int depth,
+                       unsigned int threads);
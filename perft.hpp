@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "position.hpp"
+
+// Counts the move sequences of the given length. Every placement is a move
+// on its own and combined with each of the 8 rotations when rotations are
+// enabled. Won and full positions are not expanded any further.
+template <class B>
+uint64_t perft(BasicPosition<B> *position, Token player, bool rotations,
+               unsigned int depth);
+
+struct PerftDivide {
+    Move move;
+    uint64_t nodes;
+};
+
+template <class B>
+std::vector<PerftDivide> perftDivide(const BasicPosition<B> &position,
+                                     Token player, bool rotations,
+                                     unsigned int depth, unsigned int threads);
+template <class B>
+void runPerft(const BasicPosition<B> &position, Token player, bool rotations,
+              unsigned int depth, unsigned int threads);
+// Runs perft from the empty board with the given side length, which has to
+// be one of 6, 8 or 9. Returns false for other sizes.
+bool runBoardPerft(unsigned int board_size, bool rotations,
+                   unsigned int depth, unsigned int threads);
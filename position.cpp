@@ -0,0 +1,65 @@
+#include "position.hpp"
+
+template <class B>
+Token BasicPosition<B>::at(unsigned int y, unsigned int x) const {
+    Bitboard bit = B::cellBit(y, x);
+
+    if (this->tokens[Player1] & bit) {
+        return Token::Player1;
+    }
+
+    if (this->tokens[Player2] & bit) {
+        return Token::Player2;
+    }
+
+    return Token::Empty;
+}
+
+template <class B>
+void BasicPosition<B>::set(unsigned int y, unsigned int x, Token token) {
+    Token old = this->at(y, x);
+    if (old != Token::Empty) {
+        this->tokens[old] &= ~B::cellBit(y, x);
+        this->key ^= BOARD_ZOBRIST<B>.cells[old][B::cellIndex(y, x)];
+    }
+
+    if (token != Token::Empty) {
+        this->place(B::cellIndex(y, x), token);
+    }
+}
+
+// Fills the position by parsing a simplified board
+//
+// 0 - Empty field
+// 1 - Player 1
+// 2 - Player 2
+template <class B>
+void fillPosition(BasicPosition<B> *position,
+                  const int board[B::SIZE][B::SIZE]) {
+    for (int y = 0; y < (int)B::SIZE; y++) {
+        for (int x = 0; x < (int)B::SIZE; x++) {
+            switch (board[y][x]) {
+                case 0:
+                    position->set(y, x, Token::Empty);
+                    break;
+                case 1:
+                    position->set(y, x, Token::Player1);
+                    break;
+                case 2:
+                    position->set(y, x, Token::Player2);
+                    break;
+            }
+        }
+    }
+}
+
+template struct BasicPosition<Board6>;
+template struct BasicPosition<Board8>;
+template struct BasicPosition<Board9>;
+
+template void fillPosition(BasicPosition<Board6> *position,
+                           const int board[Board6::SIZE][Board6::SIZE]);
+template void fillPosition(BasicPosition<Board8> *position,
+                           const int board[Board8::SIZE][Board8::SIZE]);
+template void fillPosition(BasicPosition<Board9> *position,
+                           const int board[Board9::SIZE][Board9::SIZE]);
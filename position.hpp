@@ -0,0 +1,560 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+enum Token {
+    Player1 = 0,
+    Player2 = 1,
+    Empty = 2,
+};
+
+inline Token otherPlayer(Token player) {
+    return player == Token::Player1 ? Token::Player2 : Token::Player1;
+}
+
+enum Rotation {
+    Clockwise = 0,
+    AntiClockwise = 1,
+};
+
+// A single turn: placing a token and optionally rotating one quad
+struct Move {
+    uint8_t cell;      // y * board size + x
+    uint8_t rotation;  // quad * 2 + Rotation, or the board's NO_ROTATION
+};
+
+constexpr uint8_t rotationCode(unsigned int quad, Rotation rotation) {
+    return quad * 2 + rotation;
+}
+
+// Counts and finds set bits of bitboards of any supported width
+constexpr unsigned int bitCount(uint64_t bits) {
+    return __builtin_popcountll(bits);
+}
+
+constexpr unsigned int bitCount(unsigned __int128 bits) {
+    return __builtin_popcountll((uint64_t)bits) +
+           __builtin_popcountll((uint64_t)(bits >> 64));
+}
+
+constexpr unsigned int lowestBit(uint64_t bits) {
+    return __builtin_ctzll(bits);
+}
+
+constexpr unsigned int lowestBit(unsigned __int128 bits) {
+    return (uint64_t)bits != 0 ? __builtin_ctzll((uint64_t)bits)
+                               : 64 + __builtin_ctzll((uint64_t)(bits >> 64));
+}
+
+// Geometry of a board made of square quads, each of which can be rotated,
+// and the amount of tokens in a row needed to win on it. Everything derived
+// from it below is computed at compile time for each board separately.
+template <unsigned int Size, unsigned int QuadSize, unsigned int WinLength>
+struct Board {
+    static_assert(Size % QuadSize == 0);
+    static_assert(WinLength <= Size);
+
+    static const unsigned int SIZE = Size;
+    // Side length of a single rotatable board part
+    static const unsigned int QUAD_SIZE = QuadSize;
+    static const unsigned int QUADS_PER_SIDE = Size / QuadSize;
+    static const unsigned int QUAD_COUNT = QUADS_PER_SIDE * QUADS_PER_SIDE;
+    static const unsigned int CELL_COUNT = Size * Size;
+    // Amount of tokens in a row needed to win
+    static const unsigned int WIN_LENGTH = WinLength;
+    static const uint8_t NO_ROTATION = QUAD_COUNT * 2;
+
+    static_assert(CELL_COUNT <= 128,
+                  "The board has to fit in a 128-bit occupancy mask");
+
+    // One bit per board cell, bit `y * SIZE + x` represents cell (y, x)
+    typedef std::conditional_t<CELL_COUNT <= 64, uint64_t, unsigned __int128>
+        Bitboard;
+
+    // All cells of the board
+    static constexpr Bitboard BOARD_MASK =
+        CELL_COUNT == sizeof(Bitboard) * 8
+            ? ~(Bitboard)0
+            : ((Bitboard)1 << CELL_COUNT) - 1;
+    // Bits of a single quad row, shifted down to the lowest bits
+    static constexpr Bitboard QUAD_ROW_MASK = ((Bitboard)1 << QuadSize) - 1;
+
+    // Lines fitting the board in each direction: along the rows and columns
+    // and along the diagonals
+    static const unsigned int LINE_STARTS = Size - WinLength + 1;
+    static const unsigned int WIN_LINE_COUNT =
+        2 * Size * LINE_STARTS + 2 * LINE_STARTS * LINE_STARTS;
+    // 64-bit words of a LineSet
+    static const unsigned int LINE_WORDS = (WIN_LINE_COUNT + 63) / 64;
+
+    static constexpr unsigned int cellIndex(unsigned int y, unsigned int x) {
+        return y * Size + x;
+    }
+
+    static constexpr Bitboard cellBit(unsigned int y, unsigned int x) {
+        return (Bitboard)1 << cellIndex(y, x);
+    }
+
+    // Index of the quad containing cell (y, x), counted along the rows of
+    // quads starting from the upper left one
+    static constexpr unsigned int quadIndex(unsigned int y, unsigned int x) {
+        return (y / QuadSize) * QUADS_PER_SIDE + x / QuadSize;
+    }
+
+    // Offset of the upper left cell of a quad
+    static constexpr unsigned int quadOrigin(unsigned int quad) {
+        return cellIndex((quad / QUADS_PER_SIDE) * QuadSize,
+                         (quad % QUADS_PER_SIDE) * QuadSize);
+    }
+
+    static constexpr Bitboard quadMask(unsigned int quad) {
+        Bitboard mask = 0;
+        for (unsigned int row = 0; row < QuadSize; row++) {
+            mask |= QUAD_ROW_MASK << (quadOrigin(quad) + row * Size);
+        }
+        return mask;
+    }
+};
+
+// The standard board, which the engines play on
+typedef Board<6, 3, 5> Board6;
+// Larger boards: four 4x4 quads and nine 3x3 quads
+typedef Board<8, 4, 5> Board8;
+typedef Board<9, 3, 5> Board9;
+
+template <class B>
+struct QuadMasks {
+    typename B::Bitboard masks[B::QUAD_COUNT];
+};
+
+template <class B>
+constexpr QuadMasks<B> makeQuadMasks() {
+    QuadMasks<B> table = {};
+    for (unsigned int quad = 0; quad < B::QUAD_COUNT; quad++) {
+        table.masks[quad] = B::quadMask(quad);
+    }
+    return table;
+}
+
+template <class B>
+inline constexpr QuadMasks<B> BOARD_QUAD_MASKS = makeQuadMasks<B>();
+
+// Rotated cells for every token pattern of a single quad row, indexed by
+// [rotation][quad][row][row pattern]
+template <class B>
+struct RotationTable {
+    typename B::Bitboard rows[2][B::QUAD_COUNT][B::QUAD_SIZE]
+                             [1 << B::QUAD_SIZE];
+};
+
+template <class B>
+constexpr RotationTable<B> makeRotationTable() {
+    typedef typename B::Bitboard Bitboard;
+    RotationTable<B> table = {};
+
+    for (unsigned int rot = 0; rot < 2; rot++) {
+        for (unsigned int quad = 0; quad < B::QUAD_COUNT; quad++) {
+            for (unsigned int row = 0; row < B::QUAD_SIZE; row++) {
+                for (unsigned int bits = 0; bits < (1 << B::QUAD_SIZE);
+                     bits++) {
+                    Bitboard rotated = 0;
+
+                    for (unsigned int col = 0; col < B::QUAD_SIZE; col++) {
+                        if (!(bits & (1 << col))) {
+                            continue;
+                        }
+
+                        // Clockwise: (row, col) -> (col, size - 1 - row)
+                        unsigned int cell =
+                            rot == Rotation::Clockwise
+                                ? B::cellIndex(col, B::QUAD_SIZE - 1 - row)
+                                : B::cellIndex(B::QUAD_SIZE - 1 - col, row);
+                        rotated |= (Bitboard)1
+                                   << (B::quadOrigin(quad) + cell);
+                    }
+
+                    table.rows[rot][quad][row][bits] = rotated;
+                }
+            }
+        }
+    }
+
+    return table;
+}
+
+template <class B>
+inline constexpr RotationTable<B> BOARD_ROTATIONS = makeRotationTable<B>();
+
+// Pseudo-random generator (splitmix64) for Zobrist keys. The fixed seed keeps
+// keys stable between runs, so they can be stored in files.
+constexpr uint64_t splitMix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+const uint64_t ZOBRIST_SEED = 0x70656e7461676f;
+
+template <class B>
+struct ZobristTable {
+    uint64_t cells[2][B::CELL_COUNT];
+    // Key change caused by rotating a quad row pattern, indexed by
+    // [player][rotation][quad][row][row pattern]
+    uint64_t rotations[2][2][B::QUAD_COUNT][B::QUAD_SIZE][1 << B::QUAD_SIZE];
+    // Mixed into search keys when Player 2 is to move
+    uint64_t side;
+    // Mixed into search keys when playing without rotations
+    uint64_t no_rotations;
+};
+
+template <class B>
+constexpr ZobristTable<B> makeZobristTable() {
+    typedef typename B::Bitboard Bitboard;
+    ZobristTable<B> table = {};
+    uint64_t state = ZOBRIST_SEED;
+
+    for (unsigned int p = 0; p < 2; p++) {
+        for (unsigned int cell = 0; cell < B::CELL_COUNT; cell++) {
+            table.cells[p][cell] = splitMix64(&state);
+        }
+    }
+
+    table.side = splitMix64(&state);
+    table.no_rotations = splitMix64(&state);
+
+    for (unsigned int p = 0; p < 2; p++) {
+        for (unsigned int rot = 0; rot < 2; rot++) {
+            for (unsigned int quad = 0; quad < B::QUAD_COUNT; quad++) {
+                const auto &rows = BOARD_ROTATIONS<B>.rows[rot][quad];
+
+                for (unsigned int row = 0; row < B::QUAD_SIZE; row++) {
+                    unsigned int shift = B::quadOrigin(quad) + row * B::SIZE;
+
+                    for (unsigned int bits = 0; bits < (1 << B::QUAD_SIZE);
+                         bits++) {
+                        uint64_t key = 0;
+                        Bitboard before = (Bitboard)bits << shift;
+                        Bitboard after = rows[row][bits];
+
+                        for (Bitboard changed = before ^ after; changed;
+                             changed &= changed - 1) {
+                            key ^= table.cells[p][lowestBit(changed)];
+                        }
+
+                        table.rotations[p][rot][quad][row][bits] = key;
+                    }
+                }
+            }
+        }
+    }
+
+    return table;
+}
+
+template <class B>
+inline constexpr ZobristTable<B> BOARD_ZOBRIST = makeZobristTable<B>();
+
+// Line directions as (dy, dx): horizontal, vertical, diagonal going down and
+// diagonal going up
+constexpr int LINE_DIRECTIONS[4][2] = { { 0, 1 }, { 1, 0 }, { 1, 1 }, { 1, -1 } };
+
+// Checks whether a line of WIN_LENGTH cells starting at (y, x) fits the board
+template <class B>
+constexpr bool lineFits(int y, int x, int direction) {
+    int end_y = y + LINE_DIRECTIONS[direction][0] * (int)(B::WIN_LENGTH - 1);
+    int end_x = x + LINE_DIRECTIONS[direction][1] * (int)(B::WIN_LENGTH - 1);
+    return end_y >= 0 && end_y < (int)B::SIZE && end_x >= 0 &&
+           end_x < (int)B::SIZE;
+}
+
+// Every line of WIN_LENGTH cells on the board, along with the cells where
+// lines start for each direction
+template <class B>
+struct WinLines {
+    typename B::Bitboard masks[B::WIN_LINE_COUNT];
+    typename B::Bitboard starts[4];
+};
+
+template <class B>
+constexpr WinLines<B> makeWinLines() {
+    WinLines<B> lines = {};
+    unsigned int i = 0;
+
+    for (int direction = 0; direction < 4; direction++) {
+        for (int y = 0; y < (int)B::SIZE; y++) {
+            for (int x = 0; x < (int)B::SIZE; x++) {
+                if (!lineFits<B>(y, x, direction)) {
+                    continue;
+                }
+
+                typename B::Bitboard mask = 0;
+                for (int k = 0; k < (int)B::WIN_LENGTH; k++) {
+                    mask |= B::cellBit(y + LINE_DIRECTIONS[direction][0] * k,
+                                       x + LINE_DIRECTIONS[direction][1] * k);
+                }
+
+                lines.masks[i++] = mask;
+                lines.starts[direction] |= B::cellBit(y, x);
+            }
+        }
+    }
+
+    return lines;
+}
+
+template <class B>
+inline constexpr WinLines<B> BOARD_WIN_LINES = makeWinLines<B>();
+
+static_assert(makeWinLines<Board6>().masks[Board6::WIN_LINE_COUNT - 1] != 0,
+              "WIN_LINE_COUNT has to match the lines fitting the board");
+static_assert(makeWinLines<Board9>().masks[Board9::WIN_LINE_COUNT - 1] != 0,
+              "WIN_LINE_COUNT has to match the lines fitting the board");
+
+// Win lines passing through every cell and through any cell of every quad,
+// as bit sets of indices into the masks of WinLines
+template <class B>
+struct LineIndex {
+    uint64_t cells[B::CELL_COUNT][B::LINE_WORDS];
+    uint64_t quads[B::QUAD_COUNT][B::LINE_WORDS];
+};
+
+template <class B>
+constexpr LineIndex<B> makeLineIndex() {
+    typedef typename B::Bitboard Bitboard;
+    LineIndex<B> index = {};
+
+    for (unsigned int i = 0; i < B::WIN_LINE_COUNT; i++) {
+        Bitboard mask = BOARD_WIN_LINES<B>.masks[i];
+        uint64_t bit = (uint64_t)1 << (i % 64);
+
+        for (unsigned int cell = 0; cell < B::CELL_COUNT; cell++) {
+            if (mask & ((Bitboard)1 << cell)) {
+                index.cells[cell][i / 64] |= bit;
+            }
+        }
+
+        for (unsigned int quad = 0; quad < B::QUAD_COUNT; quad++) {
+            if (mask & B::quadMask(quad)) {
+                index.quads[quad][i / 64] |= bit;
+            }
+        }
+    }
+
+    return index;
+}
+
+template <class B>
+inline constexpr LineIndex<B> BOARD_LINE_INDEX = makeLineIndex<B>();
+
+// Checks whether the tokens contain any complete win line. Each direction
+// is checked at once by ANDing the tokens with shifted copies of themselves,
+// which leaves a bit set at every cell starting a full line.
+template <class B>
+inline bool hasLine(typename B::Bitboard tokens) {
+    // Bit distance between neighbouring cells of a line in each direction
+    const unsigned int shifts[4] = { 1, B::SIZE, B::SIZE + 1, B::SIZE - 1 };
+    typename B::Bitboard found = 0;
+
+    for (unsigned int direction = 0; direction < 4; direction++) {
+        typename B::Bitboard line = tokens;
+        for (unsigned int k = 1; k < B::WIN_LENGTH; k++) {
+            line &= tokens >> (k * shifts[direction]);
+        }
+        found |= line & BOARD_WIN_LINES<B>.starts[direction];
+    }
+
+    return found != 0;
+}
+
+// Game position stored as one occupancy mask per player, along with its
+// Zobrist key which every change updates incrementally
+template <class B>
+struct BasicPosition {
+    typedef typename B::Bitboard Bitboard;
+
+    Bitboard tokens[2];
+    uint64_t key;
+
+    void clear() {
+        this->tokens[Player1] = this->tokens[Player2] = 0;
+        this->key = 0;
+    }
+    Bitboard occupied() const {
+        return this->tokens[Player1] | this->tokens[Player2];
+    }
+    bool full() const { return this->occupied() == B::BOARD_MASK; }
+    Token at(unsigned int y, unsigned int x) const;
+    void set(unsigned int y, unsigned int x, Token token);
+    void place(unsigned int cell, Token token) {
+        this->tokens[token] |= (Bitboard)1 << cell;
+        this->key ^= BOARD_ZOBRIST<B>.cells[token][cell];
+    }
+    void rotateQuad(unsigned int quad, Rotation rotation);
+    void remove(unsigned int cell, Token token) {
+        this->tokens[token] &= ~((Bitboard)1 << cell);
+        this->key ^= BOARD_ZOBRIST<B>.cells[token][cell];
+    }
+    void makeMove(Move move, Token token);
+    void unmakeMove(Move move, Token token);
+};
+
+// Compares the tokens only, the keys follow from them
+template <class B>
+inline bool samePosition(const BasicPosition<B> &a,
+                         const BasicPosition<B> &b) {
+    return a.tokens[Player1] == b.tokens[Player1] &&
+           a.tokens[Player2] == b.tokens[Player2];
+}
+
+template <class B>
+void fillPosition(BasicPosition<B> *position,
+                  const int board[B::SIZE][B::SIZE]);
+
+// Rotates a quad with one table lookup per quad row and player, so both
+// directions cost the same
+template <class B>
+inline void BasicPosition<B>::rotateQuad(unsigned int quad,
+                                         Rotation rotation) {
+    const auto &rows = BOARD_ROTATIONS<B>.rows[rotation][quad];
+    const unsigned int origin = B::quadOrigin(quad);
+    const Bitboard mask = BOARD_QUAD_MASKS<B>.masks[quad];
+
+    for (unsigned int p = Token::Player1; p <= Token::Player2; p++) {
+        const auto &keys = BOARD_ZOBRIST<B>.rotations[p][rotation][quad];
+        Bitboard tokens = this->tokens[p];
+        Bitboard rotated = 0;
+
+        for (unsigned int row = 0; row < B::QUAD_SIZE; row++) {
+            unsigned int bits =
+                (tokens >> (origin + row * B::SIZE)) & B::QUAD_ROW_MASK;
+            rotated |= rows[row][bits];
+            this->key ^= keys[row][bits];
+        }
+
+        this->tokens[p] = (tokens & ~mask) | rotated;
+    }
+}
+
+// Places the token and applies the rotation of a move, without any checks
+template <class B>
+inline void BasicPosition<B>::makeMove(Move move, Token token) {
+    this->place(move.cell, token);
+
+    if (move.rotation != B::NO_ROTATION) {
+        this->rotateQuad(move.rotation / 2, (Rotation)(move.rotation % 2));
+    }
+}
+
+// Exactly reverts `makeMove`, including the key
+template <class B>
+inline void BasicPosition<B>::unmakeMove(Move move, Token token) {
+    if (move.rotation != B::NO_ROTATION) {
+        this->rotateQuad(move.rotation / 2, (Rotation)((move.rotation % 2) ^ 1));
+    }
+
+    this->remove(move.cell, token);
+}
+
+// Bit set of players (1 << Token) which have completed a win line. Both
+// bits being set means that the game ended in a draw.
+const unsigned int WINNER_PLAYER1 = 1 << Token::Player1;
+const unsigned int WINNER_PLAYER2 = 1 << Token::Player2;
+
+template <class B>
+inline unsigned int winners(const BasicPosition<B> &position) {
+    return (hasLine<B>(position.tokens[Player1]) ? WINNER_PLAYER1 : 0) |
+           (hasLine<B>(position.tokens[Player2]) ? WINNER_PLAYER2 : 0);
+}
+
+// Counters of the incremental win checks
+struct WinCheckStats {
+    uint64_t checks;
+    uint64_t lines_tested;
+    uint64_t lines_skipped;
+};
+
+// Same as `winners`, but only tests the lines which the last move could have
+// completed: the ones through the placed cell and the rotated quad. The
+// position before the move must not have contained any win line.
+template <class B>
+inline unsigned int winnersAfterMove(const BasicPosition<B> &position,
+                                     Move move,
+                                     WinCheckStats *stats = nullptr) {
+    const auto &index = BOARD_LINE_INDEX<B>;
+    unsigned int result = 0;
+    unsigned int tested = 0;
+
+    for (unsigned int word = 0; word < B::LINE_WORDS; word++) {
+        uint64_t lines = index.cells[move.cell][word];
+        if (move.rotation != B::NO_ROTATION) {
+            lines |= index.quads[move.rotation / 2][word];
+        }
+        tested += __builtin_popcountll(lines);
+
+        while (lines) {
+            typename B::Bitboard mask =
+                BOARD_WIN_LINES<B>.masks[word * 64 + __builtin_ctzll(lines)];
+            lines &= lines - 1;
+
+            if ((position.tokens[Player1] & mask) == mask) {
+                result |= WINNER_PLAYER1;
+            }
+            if ((position.tokens[Player2] & mask) == mask) {
+                result |= WINNER_PLAYER2;
+            }
+        }
+    }
+
+    if (stats != nullptr) {
+        stats->checks++;
+        stats->lines_tested += tested;
+        stats->lines_skipped += B::WIN_LINE_COUNT - tested;
+    }
+
+    return result;
+}
+
+// The standard board under the names used by the engines
+typedef BasicPosition<Board6> Position;
+typedef Board6::Bitboard Bitboard;
+
+static_assert(std::is_trivially_copyable<Position>::value);
+
+const unsigned int BOARD_SIZE = Board6::SIZE;
+const unsigned int QUAD_SIZE = Board6::QUAD_SIZE;
+const unsigned int QUAD_COUNT = Board6::QUAD_COUNT;
+const unsigned int CELL_COUNT = Board6::CELL_COUNT;
+const unsigned int WIN_LENGTH = Board6::WIN_LENGTH;
+const unsigned int WIN_LINE_COUNT = Board6::WIN_LINE_COUNT;
+const uint8_t NO_ROTATION = Board6::NO_ROTATION;
+const Bitboard BOARD_MASK = Board6::BOARD_MASK;
+const Bitboard QUAD_ROW_MASK = Board6::QUAD_ROW_MASK;
+
+static_assert(QUAD_COUNT == 4 && WIN_LINE_COUNT <= 64);
+
+constexpr unsigned int cellIndex(unsigned int y, unsigned int x) {
+    return Board6::cellIndex(y, x);
+}
+
+constexpr Bitboard cellBit(unsigned int y, unsigned int x) {
+    return Board6::cellBit(y, x);
+}
+
+// Index of the quad (0 - upper left, 1 - upper right, 2 - lower left,
+// 3 - lower right) starting at the offset (y, x)
+constexpr unsigned int quadIndex(unsigned int y, unsigned int x) {
+    return Board6::quadIndex(y, x);
+}
+
+constexpr unsigned int quadOrigin(unsigned int quad) {
+    return Board6::quadOrigin(quad);
+}
+
+inline constexpr const Bitboard (&QUAD_MASKS)[QUAD_COUNT] =
+    BOARD_QUAD_MASKS<Board6>.masks;
+inline constexpr const RotationTable<Board6> &ROTATION_TABLE =
+    BOARD_ROTATIONS<Board6>;
+inline constexpr const ZobristTable<Board6> &ZOBRIST = BOARD_ZOBRIST<Board6>;
+inline constexpr const WinLines<Board6> &WIN_LINES = BOARD_WIN_LINES<Board6>;
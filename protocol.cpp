@@ -0,0 +1,339 @@
+#include "protocol.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "notation.hpp"
+#include "search.hpp"
+
+class ProtocolSession {
+   private:
+    Engine engine;
+    Position position;
+    Token player = Token::Player1;
+    bool rotations = true;
+    std::thread search_thread;
+    // Set from `go` until just before the bestmove is sent
+    std::atomic<bool> searching{ false };
+    std::atomic<bool> cancel{ false };
+    // Infinite searches wait on this for `stop`
+    std::mutex cancel_mutex;
+    std::condition_variable cancelled;
+    std::mutex output;
+
+    void send(const std::string &line);
+    void stopSearch();
+    void joinSearch();
+    void setOption(std::istringstream *args);
+    void setPosition(std::istringstream *args);
+    void go(std::istringstream *args);
+    std::string formatInfo(const SearchResult &result) const;
+
+   public:
+    ProtocolSession(unsigned int threads, const Tablebase *tablebase,
+                    const OpeningBook *book, const Network *network);
+    bool handle(const std::string &line);
+    void finish() { this->stopSearch(); }
+};
+
+// Applies moves to the position, checking that each of them can be played.
+// On failure `failed` receives the offending move.
+bool applyMoves(std::istringstream *args, bool rotations, Position *position,
+                Token *player, std::string *failed) {
+    std::string text;
+
+    while (*args >> text) {
+        Move move;
+        if (parseMove(text, rotations, &move) != MoveParseResult::MoveParsed ||
+            (position->occupied() & ((Bitboard)1 << move.cell)) ||
+            winners(*position) != 0) {
+            *failed = text;
+            return false;
+        }
+
+        position->makeMove(move, *player);
+        *player = otherPlayer(*player);
+    }
+
+    return true;
+}
+
+ProtocolSession::ProtocolSession(unsigned int threads,
+                                 const Tablebase *tablebase,
+                                 const OpeningBook *book,
+                                 const Network *network) {
+    this->position.clear();
+    this->engine.setThreads(threads);
+    this->engine.setTablebase(tablebase);
+    this->engine.setBook(book);
+    this->engine.setNetwork(network);
+    this->engine.setInfoCallback([this](const SearchResult &result) {
+        this->send(this->formatInfo(result));
+    });
+}
+
+void ProtocolSession::send(const std::string &line) {
+    std::lock_guard<std::mutex> lock(this->output);
+    std::cout << line << '\n' << std::flush;
+}
+
+// Stops a running search and waits for its bestmove
+void ProtocolSession::stopSearch() {
+    if (!this->search_thread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->cancel_mutex);
+        this->cancel = true;
+    }
+    this->cancelled.notify_all();
+    this->search_thread.join();
+}
+
+// Cleans up after a search which already sent its bestmove
+void ProtocolSession::joinSearch() {
+    if (this->search_thread.joinable()) {
+        this->search_thread.join();
+    }
+}
+
+std::string ProtocolSession::formatInfo(const SearchResult &result) const {
+    std::ostringstream out;
+    out << "info depth " << result.depth << " score ";
+
+    // Won games are reported by the amount of moves until the end
+    if (result.score >= WIN_SCORE - (int)MAX_DEPTH) {
+        out << "mate " << WIN_SCORE - result.score;
+    } else if (result.score <= -(WIN_SCORE - (int)MAX_DEPTH)) {
+        out << "mate -" << WIN_SCORE + result.score;
+    } else {
+        out << "cp " << result.score;
+    }
+
+    out << " nodes " << result.nodes << " time " << result.time_ms
+        << " nps "
+        << (result.time_ms ? result.nodes * 1000 / result.time_ms
+                           : result.nodes);
+
+    if (result.tablebase_hits != 0) {
+        out << " tbhits " << result.tablebase_hits;
+    }
+
+    out << " pv";
+
+    for (unsigned int i = 0; i < result.pv_length; i++) {
+        out << ' ' << formatMove(result.pv[i]);
+    }
+
+    return out.str();
+}
+
+void ProtocolSession::setOption(std::istringstream *args) {
+    std::string word, name, value;
+    *args >> word >> name >> word >> value;
+
+    if (name == "threads" && std::atoi(value.c_str()) > 0) {
+        this->engine.setThreads(std::atoi(value.c_str()));
+    } else if (name == "hash" && std::atoi(value.c_str()) > 0) {
+        this->engine.setHashSize(std::atoi(value.c_str()));
+    } else if (name == "mode" && (value == "pentago" || value == "tictactoe")) {
+        this->rotations = value == "pentago";
+    } else {
+        this->send("error invalid option " + name + " " + value);
+    }
+}
+
+void ProtocolSession::setPosition(std::istringstream *args) {
+    std::string type;
+    *args >> type;
+
+    Position position;
+    position.clear();
+    Token player = Token::Player1;
+
+    if (type == "board") {
+        std::string board;
+        int side = 0;
+        *args >> board >> side;
+
+        if (board.length() != CELL_COUNT || (side != 1 && side != 2) ||
+            board.find_first_not_of("012") != std::string::npos) {
+            this->send("error invalid board");
+            return;
+        }
+
+        for (unsigned int cell = 0; cell < CELL_COUNT; cell++) {
+            if (board[cell] != '0') {
+                position.place(cell, (Token)(board[cell] - '1'));
+            }
+        }
+        player = (Token)(side - 1);
+    } else if (type != "startpos") {
+        this->send("error invalid position " + type);
+        return;
+    }
+
+    std::string word, failed;
+    if (*args >> word && word != "moves") {
+        this->send("error expected moves instead of " + word);
+        return;
+    }
+
+    if (!applyMoves(args, this->rotations, &position, &player, &failed)) {
+        this->send("error illegal move " + failed);
+        return;
+    }
+
+    this->position = position;
+    this->player = player;
+}
+
+void ProtocolSession::go(std::istringstream *args) {
+    SearchLimits limits;
+    bool infinite = false;
+    std::string word;
+
+    while (*args >> word) {
+        // Limits have to be positive, 0 would mean no limit for some
+        int64_t value = 0;
+        bool limit = word == "depth" || word == "movetime" || word == "nodes";
+        if (limit && !(*args >> value && value > 0)) {
+            this->send("error invalid go parameter " + word);
+            return;
+        }
+
+        if (word == "depth") {
+            limits.depth = std::min<int64_t>(value, MAX_DEPTH);
+        } else if (word == "movetime") {
+            limits.time_ms = std::min<int64_t>(value, UINT_MAX);
+        } else if (word == "nodes") {
+            limits.nodes = value;
+        } else if (word == "infinite") {
+            infinite = true;
+        } else {
+            this->send("error invalid go parameter " + word);
+            return;
+        }
+    }
+
+    // Searches to the end of the game unless stopped, whatever the limits
+    if (infinite) {
+        limits = SearchLimits();
+    }
+
+    if (winners(this->position) != 0 || this->position.full()) {
+        this->send("bestmove none");
+        return;
+    }
+
+    this->cancel = false;
+    this->searching = true;
+    limits.cancel = &this->cancel;
+
+    this->search_thread = std::thread([this, limits, infinite]() {
+        SearchResult result = this->engine.search(
+            this->position, this->player, this->rotations, limits);
+
+        if (infinite) {
+            std::unique_lock<std::mutex> lock(this->cancel_mutex);
+            this->cancelled.wait(lock,
+                                 [this]() { return this->cancel.load(); });
+        }
+
+        this->searching = false;
+        this->send("bestmove " + formatMove(result.best_move));
+    });
+}
+
+// Handles a single command, false once the session should end
+bool ProtocolSession::handle(const std::string &line) {
+    std::istringstream args(line);
+    std::string command;
+
+    if (!(args >> command)) {
+        return true;
+    }
+
+    if (command == "isready") {
+        this->send("readyok");
+        return true;
+    } else if (command == "stop" || command == "quit") {
+        this->stopSearch();
+        return command != "quit";
+    }
+
+    // Waiting for the search here would leave a later stop unread
+    if (this->searching) {
+        this->send("error searching, stop first or wait for the bestmove");
+        return true;
+    }
+    this->joinSearch();
+
+    if (command == "uci") {
+        this->send("id name pentago");
+        this->send("option name threads type spin default 1 min 1 max " +
+                   std::to_string(MAX_THREADS));
+        this->send("option name hash type spin default " +
+                   std::to_string(TT_DEFAULT_SIZE_MB) + " min 1");
+        this->send("option name mode type combo default pentago var pentago "
+                   "var tictactoe");
+        this->send("uciok");
+    } else if (command == "setoption") {
+        this->setOption(&args);
+    } else if (command == "ucinewgame") {
+        this->engine.clear();
+    } else if (command == "position") {
+        this->setPosition(&args);
+    } else if (command == "move") {
+        Position position = this->position;
+        Token player = this->player;
+        std::string failed;
+
+        if (applyMoves(&args, this->rotations, &position, &player, &failed)) {
+            this->position = position;
+            this->player = player;
+        } else {
+            this->send("error illegal move " + failed);
+        }
+    } else if (command == "go") {
+        this->go(&args);
+    } else if (command == "print") {
+        std::string board;
+        for (unsigned int cell = 0; cell < CELL_COUNT; cell++) {
+            Token token =
+                this->position.at(cell / BOARD_SIZE, cell % BOARD_SIZE);
+            board += token == Token::Empty ? '0' : (char)('1' + token);
+        }
+        this->send("board " + board + " " + std::to_string(this->player + 1));
+    } else {
+        this->send("error unknown command " + command);
+    }
+
+    return true;
+}
+
+int runProtocol(unsigned int threads, const Tablebase *tablebase,
+                const OpeningBook *book, const Network *network) {
+    std::ios::sync_with_stdio(false);
+
+    ProtocolSession session(threads, tablebase, book, network);
+    std::string line;
+
+    while (std::getline(std::cin, line)) {
+        if (!session.handle(line)) {
+            break;
+        }
+    }
+
+    session.finish();
+
+    return 0;
+}
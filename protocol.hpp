@@ -0,0 +1,36 @@
+#pragma once
+
+// Line-based engine protocol modelled on UCI, for driving the engine from
+// other programs. Commands are read from stdin and replies written to
+// stdout, one per line:
+//
+//   uci                          - engine name and options, ends with uciok
+//   isready                      - replies readyok once all commands are done
+//   setoption name N value V     - threads, hash (MB) or mode
+//                                  (pentago or tictactoe)
+//   ucinewgame                   - forgets earlier searches
+//   position startpos [moves M...]
+//   position board B S [moves M...]
+//                                - B: 36 digits, rows from the top,
+//                                  0 empty, 1 Player 1, 2 Player 2;
+//                                  S: player to move, 1 or 2
+//   move M                       - plays a move in the current position
+//   go [depth D] [movetime MS] [nodes N] [infinite]
+//                                - searches in the background, printing an
+//                                  info line per iteration and the bestmove.
+//                                  Limits are positive numbers. An
+//                                  infinite search holds the bestmove
+//                                  until stop.
+//   stop                         - ends the search early
+//   print                        - the current position as a board command
+//   quit
+//
+// Commands other than isready, stop and quit are rejected while a search
+// runs, until its bestmove. Moves use the input notation, see `formatMove`.
+// Errors are reported with an "error" line. The tablebase, the opening book
+// and the evaluation network, if any, are used by the searches.
+class Network;
+class OpeningBook;
+class Tablebase;
+int runProtocol(unsigned int threads, const Tablebase *tablebase,
+                const OpeningBook *book, const Network *network);
@@ -0,0 +1,179 @@
+#include "rank.hpp"
+
+// Whole board rows are converted with one table lookup per row and player
+const unsigned int ROW_PATTERNS = 1 << BOARD_SIZE;
+const Bitboard ROW_MASK = ROW_PATTERNS - 1;
+// Different values of the base-3 digits of a row
+const unsigned int ROW_RANKS = threePower(BOARD_SIZE);
+
+struct RankTable {
+    // Rank of Player 1's tokens in a row, indexed by [row][row pattern].
+    // Player 2's tokens rank twice as high.
+    uint64_t rows[BOARD_SIZE][ROW_PATTERNS];
+    // Token patterns of each player in a row, indexed by the row's digits
+    uint8_t tokens[ROW_RANKS][2];
+    // Zobrist key of a row pattern, indexed by [player][row][row pattern]
+    uint64_t keys[2][BOARD_SIZE][ROW_PATTERNS];
+    // Binomial coefficients, indexed by [n][k]
+    uint64_t binomial[CELL_COUNT + 1][CELL_COUNT + 1];
+};
+
+constexpr RankTable makeRankTable() {
+    RankTable table = {};
+
+    for (unsigned int row = 0; row < BOARD_SIZE; row++) {
+        for (unsigned int bits = 0; bits < ROW_PATTERNS; bits++) {
+            for (unsigned int col = 0; col < BOARD_SIZE; col++) {
+                if (bits & (1 << col)) {
+                    unsigned int cell = cellIndex(row, col);
+                    table.rows[row][bits] += threePower(cell);
+                    table.keys[Player1][row][bits] ^=
+                        ZOBRIST.cells[Player1][cell];
+                    table.keys[Player2][row][bits] ^=
+                        ZOBRIST.cells[Player2][cell];
+                }
+            }
+        }
+    }
+
+    for (unsigned int digits = 0; digits < ROW_RANKS; digits++) {
+        unsigned int rest = digits;
+        for (unsigned int col = 0; col < BOARD_SIZE; col++, rest /= 3) {
+            if (rest % 3 != 0) {
+                table.tokens[digits][rest % 3 - 1] |= 1 << col;
+            }
+        }
+    }
+
+    for (unsigned int n = 0; n <= CELL_COUNT; n++) {
+        table.binomial[n][0] = 1;
+        for (unsigned int k = 1; k <= n; k++) {
+            table.binomial[n][k] =
+                table.binomial[n - 1][k - 1] + table.binomial[n - 1][k];
+        }
+    }
+
+    return table;
+}
+
+constexpr RankTable RANK_TABLE = makeRankTable();
+
+// Sets the key of a position whose tokens were set directly
+void updateKey(Position *position) {
+    position->key = 0;
+
+    for (unsigned int row = 0; row < BOARD_SIZE; row++) {
+        unsigned int shift = row * BOARD_SIZE;
+        position->key ^=
+            RANK_TABLE.keys[Player1][row]
+                           [(position->tokens[Player1] >> shift) & ROW_MASK] ^
+            RANK_TABLE.keys[Player2][row]
+                           [(position->tokens[Player2] >> shift) & ROW_MASK];
+    }
+}
+
+uint64_t rankPosition(const Position &position) {
+    uint64_t rank = 0;
+
+    for (unsigned int row = 0; row < BOARD_SIZE; row++) {
+        unsigned int shift = row * BOARD_SIZE;
+        rank += RANK_TABLE.rows[row][(position.tokens[Player1] >> shift) &
+                                     ROW_MASK] +
+                2 * RANK_TABLE.rows[row][(position.tokens[Player2] >> shift) &
+                                         ROW_MASK];
+    }
+
+    return rank;
+}
+
+// The rank has to be below POSITION_RANKS
+void unrankPosition(uint64_t rank, Position *position) {
+    position->clear();
+
+    for (unsigned int row = 0; row < BOARD_SIZE; row++, rank /= ROW_RANKS) {
+        const uint8_t *tokens = RANK_TABLE.tokens[rank % ROW_RANKS];
+        unsigned int shift = row * BOARD_SIZE;
+
+        position->tokens[Player1] |= (Bitboard)tokens[Player1] << shift;
+        position->tokens[Player2] |= (Bitboard)tokens[Player2] << shift;
+        position->key ^= RANK_TABLE.keys[Player1][row][tokens[Player1]] ^
+                         RANK_TABLE.keys[Player2][row][tokens[Player2]];
+    }
+}
+
+uint64_t sliceSize(unsigned int player1_tokens, unsigned int player2_tokens) {
+    unsigned int tokens = player1_tokens + player2_tokens;
+    if (tokens > CELL_COUNT) {
+        return 0;
+    }
+
+    return RANK_TABLE.binomial[CELL_COUNT][tokens] *
+           RANK_TABLE.binomial[tokens][player1_tokens];
+}
+
+// Combinations are numbered in colexicographic order: a set of cells
+// c_0 < c_1 < ... < c_k-1 gets the sum of binomial(c_i, i + 1).
+uint64_t rankInSlice(const Position &position) {
+    const auto &binomial = RANK_TABLE.binomial;
+    uint64_t cells = 0;
+    uint64_t owners = 0;
+    unsigned int tokens = 0;
+    unsigned int player1_tokens = 0;
+
+    // Player 1's cells are numbered by their order among the occupied ones
+    for (Bitboard occupied = position.occupied(); occupied;
+         occupied &= occupied - 1, tokens++) {
+        unsigned int cell = __builtin_ctzll(occupied);
+        uint64_t own = (position.tokens[Player1] >> cell) & 1;
+
+        cells += binomial[cell][tokens + 1];
+        owners += binomial[tokens][player1_tokens + 1] & -own;
+        player1_tokens += own;
+    }
+
+    return cells * binomial[tokens][player1_tokens] + owners;
+}
+
+// The index has to be below the slice's size
+void unrankInSlice(unsigned int player1_tokens, unsigned int player2_tokens,
+                   uint64_t index, Position *position) {
+    const auto &binomial = RANK_TABLE.binomial;
+    unsigned int tokens = player1_tokens + player2_tokens;
+    uint64_t cells = index / binomial[tokens][player1_tokens];
+    uint64_t owners = index % binomial[tokens][player1_tokens];
+
+    // Each member of a combination, from the highest one, is the largest
+    // value whose binomial coefficient still fits in the rest of the index
+    uint8_t occupied[CELL_COUNT];
+    unsigned int cell = CELL_COUNT;
+
+    for (unsigned int k = tokens; k > 0; k--) {
+        do {
+            cell--;
+        } while (binomial[cell][k] > cells);
+
+        cells -= binomial[cell][k];
+        occupied[k - 1] = cell;
+    }
+
+    Bitboard all = 0;
+    for (unsigned int i = 0; i < tokens; i++) {
+        all |= (Bitboard)1 << occupied[i];
+    }
+
+    Bitboard player1 = 0;
+    unsigned int order = tokens;
+
+    for (unsigned int k = player1_tokens; k > 0; k--) {
+        do {
+            order--;
+        } while (binomial[order][k] > owners);
+
+        owners -= binomial[order][k];
+        player1 |= (Bitboard)1 << occupied[order];
+    }
+
+    position->tokens[Player1] = player1;
+    position->tokens[Player2] = all & ~player1;
+    updateKey(position);
+}
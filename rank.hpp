@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+#include "position.hpp"
+
+// Dense indices of positions, for tables and files which store one entry per
+// position.
+//
+// The rank of a position reads its cells as the digits of a base-3 number,
+// with cell 0 as the lowest digit: 0 for an empty cell, 1 for Player 1 and
+// 2 for Player 2. Every position has a distinct rank below POSITION_RANKS,
+// which takes 58 bits.
+//
+// Positions with the same amounts of tokens of each player form a slice,
+// whose positions are numbered densely from 0 by combinations: first of the
+// occupied cells among all cells, then of Player 1's cells among the
+// occupied ones. Only legal token counts are worth storing, so slices are
+// much smaller than the range of ranks.
+
+constexpr uint64_t threePower(unsigned int exponent) {
+    uint64_t power = 1;
+    for (unsigned int i = 0; i < exponent; i++) {
+        power *= 3;
+    }
+    return power;
+}
+
+const uint64_t POSITION_RANKS = threePower(CELL_COUNT);
+
+uint64_t rankPosition(const Position &position);
+void unrankPosition(uint64_t rank, Position *position);
+
+// Amount of positions with the given amounts of tokens
+uint64_t sliceSize(unsigned int player1_tokens, unsigned int player2_tokens);
+// Index of the position in the slice of its token counts
+uint64_t rankInSlice(const Position &position);
+void unrankInSlice(unsigned int player1_tokens, unsigned int player2_tokens,
+                   uint64_t index, Position *position);
@@ -0,0 +1,390 @@
+#include "record.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+
+#include "notation.hpp"
+#include "rank.hpp"
+#include "util.hpp"
+
+unsigned int packMove(Move move, uint8_t *bytes) {
+    if (move.rotation == NO_ROTATION) {
+        bytes[0] = move.cell;
+        return 1;
+    }
+
+    bytes[0] = move.cell | ROTATION_FLAG;
+    bytes[1] = move.rotation;
+    return 2;
+}
+
+unsigned int unpackMove(const uint8_t *bytes, Move *move) {
+    if ((bytes[0] & ROTATION_FLAG) == 0) {
+        *move = { bytes[0], NO_ROTATION };
+        return 1;
+    }
+
+    *move = { (uint8_t)(bytes[0] & ~ROTATION_FLAG), bytes[1] };
+    return 2;
+}
+
+void startRecord(const Position &start, Token first, bool rotations,
+                 GameRecord *record) {
+    record->header = {};
+    record->header.start = rankPosition(start);
+    record->header.rotations = rotations;
+    record->header.result = GameRecordResult::RecordUnfinished;
+    record->header.first = first;
+}
+
+void setRecordPlayer(Token player, const std::string &name, char symbol,
+                     GameRecord *record) {
+    char *out = record->header.names[player];
+    std::memset(out, 0, GAME_RECORD_NAME_LEN);
+    std::memcpy(out, name.data(),
+                std::min<size_t>(name.size(), GAME_RECORD_NAME_LEN));
+    record->header.symbols[player] = symbol;
+}
+
+void recordMove(Move move, GameRecord *record) {
+    GameRecordHeader &header = record->header;
+    header.bytes += packMove(move, record->moves + header.bytes);
+    header.moves++;
+}
+
+bool validFileHeader(const GameFileHeader &header) {
+    return std::memcmp(header.magic, GAME_FILE_MAGIC,
+                       sizeof(header.magic)) == 0 &&
+           header.version == GAME_FILE_VERSION;
+}
+
+bool GameRecordWriter::open(const std::string &path) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    // An existing file has to be a record file of the same version
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    bool exists = in.is_open() && in.tellg() > 0;
+    if (exists) {
+        uint64_t size = in.tellg();
+        in.seekg(0);
+
+        GameFileHeader header;
+        if (!in.read((char *)&header, sizeof(header)) ||
+            !validFileHeader(header)) {
+            return false;
+        }
+
+        // A game cut off by an interrupted run would take the next game's
+        // bytes as its own, so the file is truncated after the last
+        // complete game
+        uint64_t end = sizeof(header);
+        GameRecordHeader game;
+        while (size - end >= sizeof(game) &&
+               in.read((char *)&game, sizeof(game)) &&
+               size - end >= sizeof(game) + game.bytes) {
+            end += sizeof(game) + game.bytes;
+            in.seekg(end);
+        }
+        in.close();
+
+        std::error_code error;
+        if (end < size) {
+            std::filesystem::resize_file(path, end, error);
+        }
+        if (error) {
+            return false;
+        }
+    }
+
+    this->out.open(path, std::ios::binary | std::ios::app);
+    if (!this->out) {
+        return false;
+    }
+
+    if (!exists) {
+        GameFileHeader header = {};
+        std::memcpy(header.magic, GAME_FILE_MAGIC, sizeof(header.magic));
+        header.version = GAME_FILE_VERSION;
+        this->out.write((const char *)&header, sizeof(header));
+    }
+
+    return (bool)this->out;
+}
+
+bool GameRecordWriter::write(const GameRecord &record) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->out.write((const char *)&record.header, sizeof(record.header));
+    this->out.write((const char *)record.moves, record.header.bytes);
+
+    return (bool)this->out;
+}
+
+bool GameRecordWriter::flush() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->out.flush();
+
+    return (bool)this->out;
+}
+
+bool GameRecordReader::open(const std::string &path) {
+    this->offset = 0;
+
+    if (!this->file.open(path)) {
+        return false;
+    }
+
+    GameFileHeader header;
+    if (this->file.size() < sizeof(header)) {
+        this->file.close();
+        return false;
+    }
+
+    std::memcpy(&header, this->file.data(), sizeof(header));
+    if (!validFileHeader(header)) {
+        this->file.close();
+        return false;
+    }
+
+    this->rewind();
+
+    return true;
+}
+
+bool GameRecordReader::next(GameView *game) {
+    uint64_t remaining = this->file.size() - this->offset;
+    if (!this->file.isOpen() || remaining < sizeof(GameRecordHeader)) {
+        return false;
+    }
+
+    // Games start at any byte, so the header is copied out
+    const uint8_t *data = this->file.data() + this->offset;
+    std::memcpy(&game->header, data, sizeof(GameRecordHeader));
+
+    uint64_t length = sizeof(GameRecordHeader) + game->header.bytes;
+    if (remaining < length) {
+        return false;
+    }
+
+    game->moves = data + sizeof(GameRecordHeader);
+    this->offset += length;
+
+    return true;
+}
+
+// Unpacks the next move of the game and plays it, returning false when the
+// moves end or the move can't be played
+bool playNextMove(const uint8_t **bytes, const uint8_t *end, Token player,
+                  Position *position, Move *move) {
+    if (*bytes >= end || ((**bytes & ROTATION_FLAG) && *bytes + 1 >= end)) {
+        return false;
+    }
+
+    *bytes += unpackMove(*bytes, move);
+    if (move->cell >= CELL_COUNT || move->rotation > NO_ROTATION ||
+        (position->occupied() >> move->cell) & 1) {
+        return false;
+    }
+
+    position->makeMove(*move, player);
+    return true;
+}
+
+unsigned int replayGame(const GameView &game, Position *position) {
+    if (game.header.start >= POSITION_RANKS ||
+        game.header.first > Token::Player2) {
+        position->clear();
+        return 0;
+    }
+
+    unrankPosition(game.header.start, position);
+
+    Token player = (Token)game.header.first;
+    const uint8_t *bytes = game.moves;
+    const uint8_t *end = game.moves + game.header.bytes;
+    unsigned int played = 0;
+    Move move;
+
+    while (played < game.header.moves &&
+           playNextMove(&bytes, end, player, position, &move)) {
+        player = otherPlayer(player);
+        played++;
+    }
+
+    return played;
+}
+
+// Result of the replayed game, or RecordUnfinished when it didn't end.
+// `valid` is cleared by illegal moves and moves after the end.
+GameRecordResult replayResult(const GameView &game, Position *position,
+                              bool *valid) {
+    *valid = game.header.first <= Token::Player2 &&
+             game.header.start < POSITION_RANKS;
+    if (!*valid) {
+        return GameRecordResult::RecordUnfinished;
+    }
+
+    unrankPosition(game.header.start, position);
+
+    Token player = (Token)game.header.first;
+    const uint8_t *bytes = game.moves;
+    const uint8_t *end = game.moves + game.header.bytes;
+    GameRecordResult result = GameRecordResult::RecordUnfinished;
+
+    for (unsigned int i = 0; i < game.header.moves; i++) {
+        Move move;
+        if (result != GameRecordResult::RecordUnfinished ||
+            !playNextMove(&bytes, end, player, position, &move)) {
+            *valid = false;
+            break;
+        }
+
+        player = otherPlayer(player);
+
+        switch (winnersAfterMove(*position, move)) {
+            case WINNER_PLAYER1:
+                result = GameRecordResult::RecordPlayer1Win;
+                break;
+            case WINNER_PLAYER2:
+                result = GameRecordResult::RecordPlayer2Win;
+                break;
+            case WINNER_PLAYER1 | WINNER_PLAYER2:
+                result = GameRecordResult::RecordDraw;
+                break;
+            default:
+                if (position->full()) {
+                    result = GameRecordResult::RecordDraw;
+                }
+                break;
+        }
+    }
+
+    return result;
+}
+
+bool replayGameFile(const std::string &path) {
+    auto start = std::chrono::steady_clock::now();
+
+    GameRecordReader reader;
+    if (!reader.open(path)) {
+        std::cout << "Can't read the game records in " << path << std::endl;
+        return false;
+    }
+
+    uint64_t games = 0, moves = 0, invalid = 0;
+    uint64_t results[4] = {};
+    GameView game;
+    Position position;
+
+    while (reader.next(&game)) {
+        bool valid;
+        GameRecordResult result = replayResult(game, &position, &valid);
+
+        // Unfinished games may stop anywhere, finished ones have to end
+        // with their last move
+        if (!valid || (game.header.result != result &&
+                       game.header.result !=
+                           GameRecordResult::RecordUnfinished)) {
+            if (invalid++ < 10) {
+                std::cout << "game " << games << " doesn't replay"
+                          << std::endl;
+            }
+        }
+
+        games++;
+        moves += game.header.moves;
+        results[std::min<unsigned int>(game.header.result, 3)]++;
+    }
+
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    std::cout << std::fixed << std::setprecision(2) << "games: " << games
+              << std::endl
+              << "player1 wins: "
+              << results[GameRecordResult::RecordPlayer1Win] << " ("
+              << percent(results[GameRecordResult::RecordPlayer1Win], games)
+              << "%)" << std::endl
+              << "player2 wins: "
+              << results[GameRecordResult::RecordPlayer2Win] << " ("
+              << percent(results[GameRecordResult::RecordPlayer2Win], games)
+              << "%)" << std::endl
+              << "draws: " << results[GameRecordResult::RecordDraw] << " ("
+              << percent(results[GameRecordResult::RecordDraw], games) << "%)"
+              << std::endl
+              << "unfinished: " << results[GameRecordResult::RecordUnfinished]
+              << std::endl
+              << "moves: " << moves << std::endl
+              << "invalid: " << invalid << std::endl
+              << "time: " << seconds << " s" << std::endl
+              << "games/s: " << (seconds > 0 ? games / seconds : 0)
+              << std::endl
+              << "MB/s: "
+              << (seconds > 0 ? reader.size() / seconds / 1e6 : 0)
+              << std::endl;
+
+    return invalid == 0;
+}
+
+bool printRecordedGame(const std::string &path, uint64_t index) {
+    GameRecordReader reader;
+    if (!reader.open(path)) {
+        std::cout << "Can't read the game records in " << path << std::endl;
+        return false;
+    }
+
+    GameView game;
+    for (uint64_t i = 0; i <= index; i++) {
+        if (!reader.next(&game)) {
+            std::cout << "There is no game " << index << std::endl;
+            return false;
+        }
+    }
+
+    const GameRecordHeader &header = game.header;
+    for (unsigned int player = Token::Player1; player <= Token::Player2;
+         player++) {
+        std::cout << "player" << player + 1 << ": "
+                  << std::string(header.names[player],
+                                 strnlen(header.names[player],
+                                         GAME_RECORD_NAME_LEN))
+                  << " (" << header.symbols[player] << ")" << std::endl;
+    }
+
+    const char *results[4] = { "player1 wins", "player2 wins", "draw",
+                               "unfinished" };
+    std::cout << "mode: " << (header.rotations ? "pentago" : "tictactoe")
+              << std::endl
+              << "result: " << results[std::min<unsigned int>(header.result, 3)]
+              << std::endl
+              << "moves:";
+
+    Position position;
+    unsigned int played = replayGame(game, &position);
+
+    const uint8_t *bytes = game.moves;
+    for (unsigned int i = 0; i < played; i++) {
+        Move move;
+        bytes += unpackMove(bytes, &move);
+        std::cout << ' ' << formatMove(move);
+    }
+    std::cout << std::endl;
+
+    if (played < header.moves) {
+        std::cout << "move " << played + 1 << " is illegal" << std::endl;
+    }
+
+    for (unsigned int y = 0; y < BOARD_SIZE; y++) {
+        for (unsigned int x = 0; x < BOARD_SIZE; x++) {
+            Token token = position.at(y, x);
+            std::cout << (token == Token::Empty ? '.' : header.symbols[token]);
+        }
+        std::cout << std::endl;
+    }
+
+    return true;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#include "mapped_file.hpp"
+#include "position.hpp"
+
+// Binary game records, written by appending to a file and read back through
+// a memory mapping.
+//
+// A record file holds a GameFileHeader followed by the games, each being a
+// GameRecordHeader and the packed moves. A move takes one byte, its cell,
+// or two bytes when it rotates a quad: the cell with ROTATION_FLAG set and
+// the rotation code (quad * 2 + Rotation). Games are read in place, so
+// iterating over a file never allocates, and a game cut off at the end of
+// the file by an interrupted writer is ignored.
+
+const char GAME_FILE_MAGIC[8] = { 'P', 'T', 'G', 'O', 'G', 'A', 'M', 'E' };
+const uint32_t GAME_FILE_VERSION = 1;
+// Bytes of a player name, zero-padded
+const unsigned int GAME_RECORD_NAME_LEN = 12;
+// Marks the first byte of a move followed by its rotation
+const uint8_t ROTATION_FLAG = 0x80;
+// Every move rotating a quad
+const unsigned int GAME_RECORD_MAX_BYTES = CELL_COUNT * 2;
+
+struct GameFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(GameFileHeader) == 16);
+
+// Values match the game's EndState
+enum GameRecordResult {
+    RecordPlayer1Win = 0,
+    RecordPlayer2Win = 1,
+    RecordDraw = 2,
+    RecordUnfinished = 3,  // Stopped before the end
+};
+
+struct GameRecordHeader {
+    uint64_t start;      // rankPosition of the starting position
+    uint8_t rotations;   // Whether moves rotate quads
+    uint8_t result;      // GameRecordResult
+    uint8_t first;       // Token of the player making the first move
+    uint8_t moves;       // Moves played
+    uint8_t bytes;       // Packed move bytes following the header
+    char symbols[2];     // Indexed by Token
+    uint8_t reserved;
+    char names[2][GAME_RECORD_NAME_LEN];
+};
+
+static_assert(sizeof(GameRecordHeader) == 40);
+
+// A game being recorded, kept in a fixed-size buffer
+struct GameRecord {
+    GameRecordHeader header;
+    uint8_t moves[GAME_RECORD_MAX_BYTES];
+};
+
+// Packs the move into `bytes`, returning the amount of bytes written
+unsigned int packMove(Move move, uint8_t *bytes);
+// Unpacks the move starting at `bytes`, returning the amount of bytes read
+unsigned int unpackMove(const uint8_t *bytes, Move *move);
+
+// Starts an unfinished record without moves or players
+void startRecord(const Position &start, Token first, bool rotations,
+                 GameRecord *record);
+// Names longer than GAME_RECORD_NAME_LEN are cut off
+void setRecordPlayer(Token player, const std::string &name, char symbol,
+                     GameRecord *record);
+void recordMove(Move move, GameRecord *record);
+
+class GameRecordWriter {
+   private:
+    std::ofstream out;
+    std::mutex mutex;
+
+   public:
+    // Appends to the file, creating it when it doesn't exist and dropping a
+    // cut-off game at its end. Returns false if it can't be written or isn't
+    // a record file.
+    bool open(const std::string &path);
+    // Appends the game, returning false on write errors. Safe to call from
+    // multiple threads.
+    bool write(const GameRecord &record);
+    bool flush();
+};
+
+// A game read in place from a record file
+struct GameView {
+    GameRecordHeader header;
+    const uint8_t *moves;  // header.bytes packed moves
+};
+
+class GameRecordReader {
+   private:
+    MappedFile file;
+    uint64_t offset = 0;
+
+   public:
+    // Returns false if the file can't be mapped or isn't a record file
+    bool open(const std::string &path);
+    // Continues from the first game
+    void rewind() { this->offset = sizeof(GameFileHeader); }
+    // Reads the next game, returning false after the last complete one
+    bool next(GameView *game);
+    uint64_t size() const { return this->file.size(); }
+};
+
+// Plays the moves of the game on its starting position, stopping at the
+// first illegal move. Returns the amount of moves played.
+unsigned int replayGame(const GameView &game, Position *position);
+
+// Replays every game of the file, checking that the moves are legal and
+// lead to the recorded result, and prints the results and the speed.
+// Returns false if the file can't be read or any game doesn't replay.
+bool replayGameFile(const std::string &path);
+// Prints the players, moves and final board of the game with the given
+// index. Returns false if there is no such game.
+bool printRecordedGame(const std::string &path, uint64_t index);
@@ -0,0 +1,228 @@
+#include "renderer.hpp"
+
+#include <algorithm>
+
+// Constructs a string used for printing box-drawing borders
+std::string border(int seg_width, int seg_count, const std::string lcor,
+                   const std::string rcor, const std::string mid,
+                   const std::string sep) {
+    std::string out;
+
+    out.append(lcor);
+
+    for (int seg = 1; seg <= seg_count; seg++) {
+        for (int i = 1; i <= seg_width; i++) {
+            out.append(mid);
+            if (seg != seg_count && i == seg_width) {
+                out.append(sep);
+            }
+        }
+    }
+
+    out.append(rcor);
+
+    return out;
+}
+
+template <class B>
+BasicBoardRenderer<B>::BasicBoardRenderer() {
+    // Amount of segments in each board region
+    int seg_n = B::QUAD_SIZE;
+    // Width of one main border segment
+    int border_width = 3 * seg_n + seg_n + 2;
+    int regions = B::QUADS_PER_SIDE;
+
+    this->frame.reserve(4096);
+
+    this->top_line = border(border_width, regions, blu, bru, bhh, bhh) + "\n";
+    this->bottom_line =
+        border(border_width, regions, bld, brd, bhh, bhh) + "\n";
+    this->quad_top_line = bvv;
+    this->quad_middle_line = bvv;
+    this->quad_bottom_line = bvv;
+    for (int region = 0; region < regions; region++) {
+        this->quad_top_line += " " + border(3, seg_n, nlu, nru, nhh, nmu);
+        this->quad_middle_line += " " + border(3, seg_n, nlc, nrc, nhh, nmc);
+        this->quad_bottom_line += " " + border(3, seg_n, nld, nrd, nhh, nmd);
+    }
+    this->quad_top_line += " " + bvv + "\n";
+    this->quad_middle_line += " " + bvv + "\n";
+    this->quad_bottom_line += " " + bvv + "\n";
+
+    // The title and the top border come first
+    unsigned int row = 3;
+
+    for (int y = 0; y < (int)B::SIZE; y++) {
+        if (y % seg_n == 0) {
+            row++;
+        }
+
+        // After the outer border, its padding and the quad border
+        unsigned int col = 4;
+
+        for (int x = 0; x < (int)B::SIZE; x++) {
+            this->cell_rows[B::cellIndex(y, x)] = row;
+            this->cell_cols[B::cellIndex(y, x)] = col + 1;
+
+            col += 4;
+            if (x % seg_n == seg_n - 1) {
+                col += 2;
+            }
+        }
+
+        // The cell row and the border below it
+        row += 2;
+    }
+
+    // Up to and including the bottom border
+    this->height = row;
+}
+
+template <class B>
+void BasicBoardRenderer<B>::moveCursor(unsigned int row, unsigned int col) {
+    this->frame.append("\033[");
+    this->frame.append(std::to_string(row));
+    this->frame.push_back(';');
+    this->frame.append(std::to_string(col));
+    this->frame.push_back('H');
+}
+
+template <class B>
+void BasicBoardRenderer<B>::composeBoard(const BasicPosition<B> &position) {
+    int seg_n = B::QUAD_SIZE;
+
+    this->frame.append("\033[2J\033[1;1H");
+    this->frame.append(this->title_line);
+    this->frame.append(this->top_line);
+
+    for (int y = 0; y < (int)B::SIZE; y++) {
+        if (y % seg_n == 0) {
+            this->frame.append(this->quad_top_line);
+        }
+
+        this->frame.append(bvv);
+        this->frame.push_back(' ');
+        this->frame.append(nvv);
+
+        for (int x = 0; x < (int)B::SIZE; x++) {
+            Token token = position.at(y, x);
+            this->frame.push_back(' ');
+            this->frame.push_back(token == Token::Empty ? ' '
+                                                        : this->symbols[token]);
+            this->frame.push_back(' ');
+
+            if (x != (int)B::SIZE - 1) {
+                this->frame.append(nvv);
+
+                if (x % seg_n == seg_n - 1) {
+                    this->frame.push_back(' ');
+                    this->frame.append(nvv);
+                }
+            }
+        }
+
+        this->frame.append(nvv);
+        this->frame.push_back(' ');
+        this->frame.append(bvv);
+        this->frame.push_back('\n');
+
+        if (y % seg_n == seg_n - 1) {
+            this->frame.append(this->quad_bottom_line);
+        } else {
+            this->frame.append(this->quad_middle_line);
+        }
+    }
+
+    this->frame.append(this->bottom_line);
+}
+
+// Redraws the cells which changed and clears the old status text
+template <class B>
+void BasicBoardRenderer<B>::composeChanges(const BasicPosition<B> &position) {
+    typename B::Bitboard changed =
+        (this->drawn.tokens[Player1] ^ position.tokens[Player1]) |
+        (this->drawn.tokens[Player2] ^ position.tokens[Player2]);
+
+    for (; changed != 0; changed &= changed - 1) {
+        unsigned int cell = lowestBit(changed);
+        Token token = position.at(cell / B::SIZE, cell % B::SIZE);
+
+        this->moveCursor(this->cell_rows[cell], this->cell_cols[cell]);
+        this->frame.push_back(token == Token::Empty ? ' '
+                                                    : this->symbols[token]);
+    }
+
+    this->moveCursor(this->height + 1, 1);
+    this->frame.append("\033[J");
+}
+
+template <class B>
+void BasicBoardRenderer<B>::render(std::ostream &out, const std::string &title,
+                                   const BasicPosition<B> &position,
+                                   const char symbols[2],
+                                   const std::string &status) {
+    std::lock_guard<std::mutex> lock(this->output);
+
+    if (title != this->title || symbols[0] != this->symbols[0] ||
+        symbols[1] != this->symbols[1]) {
+        // Width of the entire game board
+        int board_width = (3 * B::QUAD_SIZE + B::QUAD_SIZE + 2) *
+                              B::QUADS_PER_SIDE +
+                          B::QUADS_PER_SIDE + 1;
+        int pad_len = std::max(0, board_width - (int)title.length()) / 2;
+
+        this->title = title;
+        this->title_line = std::string(pad_len, ' ') + title + "\n";
+        this->symbols[0] = symbols[0];
+        this->symbols[1] = symbols[1];
+        this->valid = false;
+    }
+
+    this->frame.clear();
+
+    if (this->valid) {
+        this->composeChanges(position);
+    } else {
+        this->composeBoard(position);
+    }
+
+    this->frame.append(status);
+
+    out.write(this->frame.data(), this->frame.size());
+    out.flush();
+
+    this->drawn = position;
+    this->valid = true;
+}
+
+template <class B>
+void BasicBoardRenderer<B>::renderStatusLine(std::ostream &out,
+                                             unsigned int line,
+                                             const std::string &text) {
+    std::lock_guard<std::mutex> lock(this->output);
+
+    // The line's position is only known with the board on the screen
+    if (!this->valid) {
+        return;
+    }
+
+    this->frame.clear();
+    this->frame.append("\0337");
+    this->moveCursor(this->height + 1 + line, 1);
+    this->frame.append("\033[2K");
+    this->frame.append(text);
+    this->frame.append("\0338");
+
+    out.write(this->frame.data(), this->frame.size());
+    out.flush();
+}
+
+template <class B>
+void BasicBoardRenderer<B>::invalidate() {
+    std::lock_guard<std::mutex> lock(this->output);
+    this->valid = false;
+}
+
+template class BasicBoardRenderer<Board6>;
+template class BasicBoardRenderer<Board8>;
+template class BasicBoardRenderer<Board9>;
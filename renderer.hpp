@@ -0,0 +1,82 @@
+#pragma once
+
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "position.hpp"
+
+inline const std::string nlu = "\u250c";  // ┌
+inline const std::string nlc = "\u251c";  // ├
+inline const std::string nld = "\u2514";  // └
+inline const std::string nru = "\u2510";  // ┐
+inline const std::string nrc = "\u2524";  // ┤
+inline const std::string nrd = "\u2518";  // ┘
+inline const std::string nmu = "\u252c";  // ┬
+inline const std::string nmc = "\u253c";  // ┼
+inline const std::string nmd = "\u2534";  // ┴
+inline const std::string nvv = "\u2502";  // │
+inline const std::string nhh = "\u2500";  // ─
+inline const std::string blu = "\u2554";  // ╔
+inline const std::string blc = "\u2560";  // ╠
+inline const std::string bld = "\u255a";  // ╚
+inline const std::string bru = "\u2557";  // ╗
+inline const std::string brc = "\u2563";  // ╣
+inline const std::string brd = "\u255d";  // ╝
+inline const std::string bmu = "\u2566";  // ╦
+inline const std::string bmc = "\u256c";  // ╬
+inline const std::string bmd = "\u2569";  // ╩
+inline const std::string bvv = "\u2551";  // ║
+inline const std::string bhh = "\u2550";  // ═
+
+std::string border(int seg_width, int seg_count, const std::string lcor,
+                   const std::string rcor, const std::string mid,
+                   const std::string sep);
+
+// Draws the board at the top of the terminal, followed by free-form status
+// text. Each frame is composed in a single buffer and written at once.
+//
+// The board lines which never change are built once. After the first frame
+// only the cells which changed since the previous one are drawn, by moving
+// the cursor onto them, and the status text below the board is replaced.
+// Anything else drawing over the board has to call `invalidate` so that
+// the next frame is drawn in full.
+//
+// Single status lines can be replaced from other threads between frames,
+// leaving the cursor where it was.
+template <class B>
+class BasicBoardRenderer {
+   private:
+    std::string frame;
+    std::string title_line;
+    std::string top_line;
+    std::string bottom_line;
+    std::string quad_top_line;
+    std::string quad_middle_line;
+    std::string quad_bottom_line;
+    // Screen row and column (1-based) of the symbol of each cell
+    unsigned int cell_rows[B::CELL_COUNT];
+    unsigned int cell_cols[B::CELL_COUNT];
+    unsigned int height;  // Screen rows taken by the title and the board
+
+    std::mutex output;
+    bool valid = false;
+    std::string title;
+    BasicPosition<B> drawn;
+    char symbols[2] = { 0, 0 };
+
+    void composeBoard(const BasicPosition<B> &position);
+    void composeChanges(const BasicPosition<B> &position);
+    void moveCursor(unsigned int row, unsigned int col);
+
+   public:
+    BasicBoardRenderer();
+    void render(std::ostream &out, const std::string &title,
+                const BasicPosition<B> &position, const char symbols[2],
+                const std::string &status);
+    void renderStatusLine(std::ostream &out, unsigned int line,
+                          const std::string &text);
+    void invalidate();
+};
+
+typedef BasicBoardRenderer<Board6> BoardRenderer;
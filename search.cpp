@@ -0,0 +1,443 @@
+#include "search.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "book.hpp"
+#include "eval.hpp"
+#include "symmetry.hpp"
+#include "tablebase.hpp"
+
+// Amount of nodes searched between checks of the clock
+const uint64_t TIME_CHECK_INTERVAL = 1024;
+
+// Score of a finished game for `player`, who made the last move at `ply`
+int terminalScore(unsigned int result, Token player, unsigned int ply) {
+    if (result == (WINNER_PLAYER1 | WINNER_PLAYER2)) {
+        return 0;
+    }
+
+    if (result & (1 << player)) {
+        return WIN_SCORE - (int)ply;
+    }
+
+    return -(WIN_SCORE - (int)ply);
+}
+
+// Scores of won games are stored relative to the node, not the root
+int scoreToTT(int score, unsigned int ply) {
+    if (score >= WIN_SCORE - (int)MAX_DEPTH) {
+        return score + ply;
+    }
+    if (score <= -(WIN_SCORE - (int)MAX_DEPTH)) {
+        return score - ply;
+    }
+    return score;
+}
+
+int scoreFromTT(int score, unsigned int ply) {
+    if (score >= WIN_SCORE - (int)MAX_DEPTH) {
+        return score - ply;
+    }
+    if (score <= -(WIN_SCORE - (int)MAX_DEPTH)) {
+        return score + ply;
+    }
+    return score;
+}
+
+// Moves the given move to the front of the list, if it's there
+void orderFirst(MoveList *list, Move move) {
+    for (unsigned int i = 0; i < list->count; i++) {
+        if (list->moves[i].cell == move.cell &&
+            list->moves[i].rotation == move.rotation) {
+            std::swap(list->moves[0], list->moves[i]);
+            return;
+        }
+    }
+}
+
+Engine::Engine() : tt(TT_DEFAULT_SIZE_MB) {
+    this->rotations = true;
+    this->threads = 1;
+    this->nodes = 0;
+    this->stopped = false;
+}
+
+void Engine::setThreads(unsigned int threads) {
+    this->threads = std::clamp(threads, 1u, MAX_THREADS);
+}
+
+unsigned int Engine::elapsedMs() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - this->start)
+        .count();
+}
+
+// Transposition table key shared by all symmetric variants of the position.
+// `symmetry` receives the symmetry mapping moves into the stored variant.
+uint64_t Engine::searchKey(const Position &position, Token player,
+                           unsigned int *symmetry) const {
+    uint64_t key = canonicalKey(position, symmetry);
+
+    if (player == Token::Player2) {
+        key ^= ZOBRIST.side;
+    }
+    if (!this->rotations) {
+        key ^= ZOBRIST.no_rotations;
+    }
+
+    return key;
+}
+
+// Checks the node and time budget and the cancel flag, stopping all threads
+// when the search has to end. Threads add their node counts to the shared
+// total in batches.
+bool Engine::outOfBudget(SearchWorker *worker) {
+    if (this->stopped.load(std::memory_order_relaxed)) {
+        return true;
+    }
+
+    if (worker->nodes - worker->reported_nodes >= TIME_CHECK_INTERVAL) {
+        this->nodes.fetch_add(worker->nodes - worker->reported_nodes,
+                              std::memory_order_relaxed);
+        worker->reported_nodes = worker->nodes;
+
+        if (this->limits.time_ms != 0 &&
+            this->elapsedMs() >= this->limits.time_ms) {
+            this->stopped = true;
+        }
+
+        if (this->limits.cancel != nullptr &&
+            this->limits.cancel->load(std::memory_order_relaxed)) {
+            this->stopped = true;
+        }
+    }
+
+    if (this->limits.nodes != 0 &&
+        this->nodes.load(std::memory_order_relaxed) + worker->nodes -
+                worker->reported_nodes >=
+            this->limits.nodes) {
+        this->stopped = true;
+    }
+
+    return this->stopped.load(std::memory_order_relaxed);
+}
+
+// Searches the worker's position in place, making and unmaking moves on it
+int Engine::negamax(SearchWorker *worker, Token player, unsigned int depth,
+                    int alpha, int beta, unsigned int ply) {
+    Position *position = &worker->position;
+    TablebaseValue value;
+
+    if (this->tablebase != nullptr &&
+        this->tablebase->probe(*position, player, this->rotations, &value)) {
+        worker->tablebase_hits++;
+        return (value - TablebaseDraw) * TABLEBASE_WIN_SCORE;
+    }
+
+    if (depth == 0) {
+        return this->network != nullptr
+                   ? this->network->evaluate(worker->accumulators[ply], player)
+                   : evaluate(*position, player);
+    }
+
+    int alpha_orig = alpha;
+    unsigned int symmetry;
+    uint64_t key = this->searchKey(*position, player, &symmetry);
+
+    TTEntry entry;
+    bool found = this->tt.probe(key, &entry, &worker->tt);
+    if (found && entry.depth >= depth) {
+        int score = scoreFromTT(entry.score, ply);
+
+        if (entry.bound() == Bound::Exact) {
+            return score;
+        } else if (entry.bound() == Bound::LowerBound) {
+            alpha = std::max(alpha, score);
+        } else {
+            beta = std::min(beta, score);
+        }
+
+        if (alpha >= beta) {
+            return score;
+        }
+    }
+
+    MoveList list;
+    generateMoves(*position, player, this->rotations, &list);
+    worker->raw_moves += list.raw_count;
+    worker->unique_moves += list.count;
+
+    if (found) {
+        orderFirst(&list, transformMove(entry.move, inverseSymmetry(symmetry)));
+    }
+
+    int best = -INFINITE_SCORE;
+    Move best_move = list.moves[0];
+
+    for (unsigned int i = 0; i < list.count; i++) {
+        Move move = list.moves[i];
+        position->makeMove(move, player);
+        worker->nodes++;
+
+        int score;
+        unsigned int result = winnersAfterMove(*position, move);
+        if (result != 0) {
+            score = terminalScore(result, player, ply + 1);
+        } else if (position->full()) {
+            score = 0;
+        } else {
+            if (this->network != nullptr) {
+                this->network->update(worker->accumulators[ply], *position,
+                                      move, player,
+                                      &worker->accumulators[ply + 1]);
+            }
+            score = -this->negamax(worker, otherPlayer(player), depth - 1,
+                                   -beta, -alpha, ply + 1);
+        }
+
+        position->unmakeMove(move, player);
+
+        if (this->outOfBudget(worker)) {
+            return 0;
+        }
+
+        if (score > best) {
+            best = score;
+            best_move = move;
+        }
+
+        if (score > alpha) {
+            alpha = score;
+        }
+
+        if (alpha >= beta) {
+            break;
+        }
+    }
+
+    Bound bound = best <= alpha_orig ? Bound::UpperBound
+                  : best >= beta     ? Bound::LowerBound
+                                     : Bound::Exact;
+    this->tt.store(key, scoreToTT(best, ply), depth, bound,
+                   transformMove(best_move, symmetry), &worker->tt);
+
+    return best;
+}
+
+// Searches the worker's position with increasing depth until the limits run
+// out. The result always comes from the deepest iteration which finished,
+// except when not even the first one did.
+void Engine::iterate(SearchWorker *worker, Token player, MoveList list) {
+    Position *root = &worker->position;
+    SearchResult &result = worker->result;
+    result.best_move = list.moves[0];
+    result.score = -INFINITE_SCORE;
+
+    unsigned int symmetry;
+    uint64_t key = this->searchKey(*root, player, &symmetry);
+
+    unsigned int empty = __builtin_popcountll(~root->occupied() & BOARD_MASK);
+    unsigned int max_depth = std::min(this->limits.depth, empty);
+
+    if (this->network != nullptr) {
+        this->network->refresh(*root, &worker->accumulators[0]);
+    }
+
+    // Helpers spread out over the root moves and depths
+    if (worker->id != 0) {
+        std::rotate(list.moves, list.moves + worker->id % list.count,
+                    list.moves + list.count);
+    }
+
+    for (unsigned int depth = 1 + worker->id % 2; depth <= max_depth;
+         depth++) {
+        int alpha = -INFINITE_SCORE;
+        Move best_move = list.moves[0];
+        bool finished = true;
+
+        for (unsigned int i = 0; i < list.count; i++) {
+            Move move = list.moves[i];
+            root->makeMove(move, player);
+            worker->nodes++;
+
+            int score;
+            unsigned int winners = winnersAfterMove(*root, move);
+            if (winners != 0) {
+                score = terminalScore(winners, player, 1);
+            } else if (root->full()) {
+                score = 0;
+            } else {
+                if (this->network != nullptr) {
+                    this->network->update(worker->accumulators[0], *root,
+                                          move, player,
+                                          &worker->accumulators[1]);
+                }
+                score = -this->negamax(worker, otherPlayer(player), depth - 1,
+                                       -INFINITE_SCORE, -alpha, 1);
+            }
+
+            root->unmakeMove(move, player);
+
+            if (this->outOfBudget(worker)) {
+                finished = false;
+                break;
+            }
+
+            if (score > alpha) {
+                alpha = score;
+                best_move = move;
+            }
+        }
+
+        if (!finished) {
+            if (result.depth == 0 && alpha > -INFINITE_SCORE) {
+                result.best_move = best_move;
+                result.score = alpha;
+            }
+            break;
+        }
+
+        result.best_move = best_move;
+        result.score = alpha;
+        result.depth = depth;
+        this->tt.store(key, alpha, depth, Bound::Exact,
+                       transformMove(best_move, symmetry), &worker->tt);
+
+        if (worker->id == 0 && this->info) {
+            result.nodes = this->nodes.load(std::memory_order_relaxed) +
+                           worker->nodes - worker->reported_nodes;
+            result.time_ms = this->elapsedMs();
+            result.tablebase_hits = worker->tablebase_hits;
+            this->findPrincipalVariation(*root, player, &result);
+            this->info(result);
+        }
+
+        // Search the best move first in the next iteration
+        orderFirst(&list, best_move);
+
+        // A forced result can't change with more depth
+        if (alpha >= WIN_SCORE - (int)MAX_DEPTH ||
+            alpha <= -(WIN_SCORE - (int)MAX_DEPTH)) {
+            break;
+        }
+    }
+}
+
+// Follows the best moves stored in the transposition table from the root,
+// at most as deep as the search went
+void Engine::findPrincipalVariation(const Position &position, Token player,
+                                    SearchResult *result) {
+    Position current = position;
+    Move move = result->best_move;
+    TTStats stats = {};
+
+    result->pv_length = 0;
+
+    while (true) {
+        result->pv[result->pv_length++] = move;
+        current.makeMove(move, player);
+
+        if (result->pv_length >= result->depth ||
+            winnersAfterMove(current, move) != 0 || current.full()) {
+            break;
+        }
+
+        player = otherPlayer(player);
+
+        unsigned int symmetry;
+        TTEntry entry;
+        if (!this->tt.probe(this->searchKey(current, player, &symmetry),
+                            &entry, &stats)) {
+            break;
+        }
+
+        move = transformMove(entry.move, inverseSymmetry(symmetry));
+        if (current.occupied() & ((Bitboard)1 << move.cell)) {
+            break;
+        }
+    }
+}
+
+SearchResult Engine::search(const Position &position, Token player,
+                            bool rotations, const SearchLimits &limits) {
+    this->rotations = rotations;
+    this->limits = limits;
+    this->start = std::chrono::steady_clock::now();
+    this->nodes = 0;
+    this->stopped = false;
+    this->tt.newSearch();
+
+    SearchResult book = {};
+    if (this->book != nullptr &&
+        this->book->probe(position, player, rotations, &book.best_move,
+                          &book.score, &book.depth) &&
+        !(position.occupied() & ((Bitboard)1 << book.best_move.cell))) {
+        book.from_book = true;
+        book.pv[0] = book.best_move;
+        book.pv_length = 1;
+        book.tt = this->tt.getStats();
+        book.time_ms = this->elapsedMs();
+        if (this->info) {
+            this->info(book);
+        }
+        return book;
+    }
+
+    std::vector<SearchWorker> workers(this->threads);
+    for (unsigned int i = 0; i < this->threads; i++) {
+        workers[i] = {};
+        workers[i].id = i;
+        workers[i].position = position;
+    }
+
+    // Moves leading to symmetric positions have the same score, so only one
+    // of them is searched
+    MoveList list;
+    generateRootMoves(position, player, this->rotations, &list);
+
+    // Start with the move remembered from earlier searches
+    unsigned int symmetry;
+    uint64_t key = this->searchKey(position, player, &symmetry);
+    TTEntry entry;
+    if (this->tt.probe(key, &entry, &workers[0].tt)) {
+        orderFirst(&list, transformMove(entry.move, inverseSymmetry(symmetry)));
+    }
+
+    std::vector<std::thread> helpers;
+    for (unsigned int i = 1; i < this->threads; i++) {
+        helpers.emplace_back(&Engine::iterate, this, &workers[i], player, list);
+    }
+
+    this->iterate(&workers[0], player, list);
+    this->stopped = true;
+
+    for (std::thread &helper : helpers) {
+        helper.join();
+    }
+
+    SearchResult result = workers[0].result;
+    result.nodes = 0;
+    result.raw_moves = list.raw_count;
+    result.unique_moves = list.count;
+    result.tablebase_hits = 0;
+    result.tt = this->tt.getStats();
+
+    for (const SearchWorker &worker : workers) {
+        result.nodes += worker.nodes;
+        result.raw_moves += worker.raw_moves;
+        result.unique_moves += worker.unique_moves;
+        result.tablebase_hits += worker.tablebase_hits;
+        result.tt.probes += worker.tt.probes;
+        result.tt.hits += worker.tt.hits;
+        result.tt.collisions += worker.tt.collisions;
+        result.tt.stores += worker.tt.stores;
+    }
+
+    result.time_ms = this->elapsedMs();
+    this->findPrincipalVariation(position, player, &result);
+
+    return result;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include "movegen.hpp"
+#include "nnue.hpp"
+#include "position.hpp"
+#include "tt.hpp"
+
+// Score of a won game, reduced by the ply of the win so that faster wins are
+// preferred over slower ones
+const int WIN_SCORE = 1000000;
+const int INFINITE_SCORE = WIN_SCORE + 1;
+const unsigned int MAX_DEPTH = CELL_COUNT;
+// Score of a tablebase win, which has no distance to the win. It's below
+// every found win and above every evaluation.
+const int TABLEBASE_WIN_SCORE = WIN_SCORE - 2 * (int)MAX_DEPTH;
+// Per-move time budget of computer players
+const unsigned int ENGINE_MOVE_TIME_MS = 100;
+const unsigned int MAX_THREADS = 64;
+
+struct SearchLimits {
+    unsigned int depth = MAX_DEPTH;
+    unsigned int time_ms = 0;  // 0 - no time limit
+    uint64_t nodes = 0;        // 0 - no node limit
+    // Stops the search once set, checked along with the time limit
+    const std::atomic<bool> *cancel = nullptr;
+};
+
+struct SearchResult {
+    Move best_move;
+    int score;
+    unsigned int depth;  // Deepest fully searched iteration
+    uint64_t nodes;
+    unsigned int time_ms;
+    TTStats tt;
+    // Moves generated in all searched nodes, before and after removing the
+    // ones leading to duplicate positions
+    uint64_t raw_moves;
+    uint64_t unique_moves;
+    uint64_t tablebase_hits;
+    bool from_book;  // Taken from the opening book without a search
+    // Expected continuation starting with the best move, read from the
+    // transposition table
+    Move pv[MAX_DEPTH];
+    unsigned int pv_length;
+};
+
+class OpeningBook;
+class Tablebase;
+
+// Called by the main search thread after every finished iteration
+typedef std::function<void(const SearchResult &)> SearchInfoCallback;
+
+// State of a single search thread
+struct SearchWorker {
+    unsigned int id;
+    Position position;
+    uint64_t nodes;
+    uint64_t reported_nodes;  // Nodes already added to the engine total
+    uint64_t raw_moves;
+    uint64_t unique_moves;
+    uint64_t tablebase_hits;
+    TTStats tt;
+    SearchResult result;
+    // Network accumulators of the positions along the searched line, by ply
+    Accumulator accumulators[MAX_DEPTH + 1];
+};
+
+// Negamax alpha-beta search with iterative deepening, stopped by the depth,
+// time or node limit, whichever comes first.
+//
+// With more than one thread the search runs Lazy SMP style: every thread
+// searches the same root on its own, sharing only the transposition table.
+// Helper threads start at alternating depths and with the root moves in a
+// different order, so they fill the table with results the main thread
+// needs soon. The result always comes from the main thread.
+class Engine {
+   private:
+    bool rotations;
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point start;
+    unsigned int threads;
+    std::atomic<bool> stopped;
+    std::atomic<uint64_t> nodes;
+    TranspositionTable tt;
+    SearchInfoCallback info;
+    const Tablebase *tablebase = nullptr;
+    const OpeningBook *book = nullptr;
+    const Network *network = nullptr;
+    bool outOfBudget(SearchWorker *worker);
+    uint64_t searchKey(const Position &position, Token player,
+                       unsigned int *symmetry) const;
+    int negamax(SearchWorker *worker, Token player, unsigned int depth,
+                int alpha, int beta, unsigned int ply);
+    void iterate(SearchWorker *worker, Token player, MoveList list);
+    void findPrincipalVariation(const Position &position, Token player,
+                                SearchResult *result);
+
+   public:
+    Engine();
+    SearchResult search(const Position &position, Token player,
+                        bool rotations, const SearchLimits &limits);
+    void clear() { this->tt.clear(); }
+    void setHashSize(unsigned int size_mb) { this->tt.resize(size_mb); }
+    void setThreads(unsigned int threads);
+    void setInfoCallback(SearchInfoCallback info) { this->info = info; }
+    // Positions found in the tablebase get its result without a search
+    void setTablebase(const Tablebase *tablebase) {
+        this->tablebase = tablebase;
+    }
+    // Positions found in the book are answered with its move right away
+    void setBook(const OpeningBook *book) { this->book = book; }
+    // Leaves are scored by the network instead of `evaluate`
+    void setNetwork(const Network *network) { this->network = network; }
+    unsigned int elapsedMs() const;
+};
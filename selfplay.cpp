@@ -0,0 +1,337 @@
+#include "selfplay.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "eval.hpp"
+#include "mcts.hpp"
+#include "movegen.hpp"
+#include "search.hpp"
+#include "util.hpp"
+
+// Transposition table size of each self-play thread's engine
+const unsigned int SELFPLAY_HASH_MB = 4;
+// Tree nodes of each self-play thread's Monte Carlo engines
+const uint32_t SELFPLAY_MCTS_NODES = 1 << 18;
+// Games claimed by a thread at once
+const uint64_t SELFPLAY_BATCH = 64;
+
+// Engines used by a self-play thread, created only for the agents which
+// need them. Every player gets its own Monte Carlo engine, so that each
+// keeps its tree between its own moves.
+struct SelfPlayEngines {
+    std::unique_ptr<Engine> engine;
+    std::unique_ptr<MctsEngine> mcts[2];
+};
+
+// Parses "random", "greedy", "engine:<depth>" or "mcts:<playouts>"
+int parseAgent(const std::string &spec, AgentConfig *agent) {
+    if (spec == "random") {
+        *agent = { AgentType::RandomAgent, 0 };
+        return 0;
+    }
+
+    if (spec == "greedy") {
+        *agent = { AgentType::GreedyAgent, 0 };
+        return 0;
+    }
+
+    if (spec.rfind("engine:", 0) == 0) {
+        int depth = std::atoi(spec.c_str() + 7);
+        if (depth < 1 || depth > (int)MAX_DEPTH) {
+            return -1;
+        }
+
+        *agent = { AgentType::EngineAgent, (unsigned int)depth };
+        return 0;
+    }
+
+    if (spec.rfind("mcts:", 0) == 0) {
+        long long playouts = std::atoll(spec.c_str() + 5);
+        if (playouts < 1) {
+            return -1;
+        }
+
+        *agent = { AgentType::MctsAgent, 0, (uint64_t)playouts };
+        return 0;
+    }
+
+    return -1;
+}
+
+std::string formatAgent(const AgentConfig &agent) {
+    switch (agent.type) {
+        case AgentType::RandomAgent:
+            return "random";
+        case AgentType::GreedyAgent:
+            return "greedy";
+        case AgentType::EngineAgent:
+            return "engine:" + std::to_string(agent.depth);
+        case AgentType::MctsAgent:
+            return "mcts:" + std::to_string(agent.playouts);
+    }
+
+    return "";
+}
+
+// Plays a winning move if there is one, otherwise the move with the best
+// static evaluation, breaking ties at random. The children still in play
+// are evaluated in one batch.
+Move greedyMove(const Position &position, Token player, bool rotations,
+                Rng *rng) {
+    MoveList list;
+    generateMoves(position, player, rotations, &list);
+
+    Position children[MAX_MOVES];
+    Token players[MAX_MOVES];
+    int scores[MAX_MOVES];
+    unsigned int results[MAX_MOVES];
+
+    for (unsigned int i = 0; i < list.count; i++) {
+        children[i] = position;
+        children[i].makeMove(list.moves[i], player);
+        players[i] = player;
+
+        results[i] = winnersAfterMove(children[i], list.moves[i]);
+        if (results[i] == (1u << player)) {
+            return list.moves[i];
+        }
+    }
+
+    evaluateBatch(children, players, list.count, scores);
+
+    Move best_move = list.moves[0];
+    int best = -INFINITE_SCORE;
+    unsigned int ties = 0;
+
+    for (unsigned int i = 0; i < list.count; i++) {
+        int score = scores[i];
+        if (results[i] != 0) {
+            // A draw, or a rotation completing the opponent's line
+            score = results[i] == (WINNER_PLAYER1 | WINNER_PLAYER2)
+                        ? 0
+                        : -WIN_SCORE;
+        }
+
+        if (score > best) {
+            best = score;
+            best_move = list.moves[i];
+            ties = 1;
+        } else if (score == best && rng->below(++ties) == 0) {
+            best_move = list.moves[i];
+        }
+    }
+
+    return best_move;
+}
+
+Move chooseMove(const AgentConfig &agent, const Position &position,
+                Token player, bool rotations, SelfPlayEngines *engines,
+                Rng *rng) {
+    switch (agent.type) {
+        case AgentType::GreedyAgent:
+            return greedyMove(position, player, rotations, rng);
+        case AgentType::EngineAgent: {
+            SearchLimits limits;
+            limits.depth = agent.depth;
+            return engines->engine
+                ->search(position, player, rotations, limits)
+                .best_move;
+        }
+        case AgentType::MctsAgent: {
+            MctsLimits limits;
+            limits.playouts = agent.playouts;
+            return engines->mcts[player]
+                ->search(position, player, rotations, limits)
+                .best_move;
+        }
+        default:
+            return randomMove(position, rotations, rng);
+    }
+}
+
+// Symbols of the players in the game records
+const char SELFPLAY_SYMBOLS[2] = { 'x', 'o' };
+
+// Plays a single game without any output, adding its moves to the record.
+// Returns the winner, or Token::Empty for a draw.
+Token playGame(const SelfPlayConfig &config, uint64_t index,
+               SelfPlayEngines *engines, unsigned int *length,
+               GameRecord *record) {
+    Rng rng(config.seed ^ (index * 0xd1b54a32d192ed03));
+    Position position;
+    position.clear();
+
+    // Nothing learned in earlier games of the thread is kept, so that the
+    // moves depend only on the game's seed
+    if (engines->engine) {
+        engines->engine->clear();
+    }
+    for (std::unique_ptr<MctsEngine> &mcts : engines->mcts) {
+        if (mcts) {
+            mcts->clear();
+        }
+    }
+
+    // Players take turns starting first
+    Token player = index % 2 == 0 ? Token::Player1 : Token::Player2;
+    startRecord(position, player, config.rotations, record);
+
+    for (unsigned int ply = 0;; ply++) {
+        Move move =
+            ply < config.random_plies
+                ? randomMove(position, config.rotations, &rng)
+                : chooseMove(config.agents[player], position, player,
+                             config.rotations, engines, &rng);
+        position.makeMove(move, player);
+        recordMove(move, record);
+
+        unsigned int result = winnersAfterMove(position, move);
+        if (result != 0 || position.full()) {
+            *length = ply + 1;
+
+            if (result == WINNER_PLAYER1) {
+                record->header.result = GameRecordResult::RecordPlayer1Win;
+                return Token::Player1;
+            } else if (result == WINNER_PLAYER2) {
+                record->header.result = GameRecordResult::RecordPlayer2Win;
+                return Token::Player2;
+            }
+            record->header.result = GameRecordResult::RecordDraw;
+            return Token::Empty;
+        }
+
+        player = otherPlayer(player);
+    }
+}
+
+// Plays games claimed from the shared counter until all are taken
+void selfPlayThread(const SelfPlayConfig *config, std::atomic<uint64_t> *next,
+                    SelfPlayStats *stats) {
+    SelfPlayEngines engines;
+    for (const AgentConfig &agent : config->agents) {
+        if (agent.type == AgentType::EngineAgent && !engines.engine) {
+            engines.engine.reset(new Engine());
+            engines.engine->setHashSize(SELFPLAY_HASH_MB);
+        }
+    }
+
+    for (unsigned int player = 0; player < 2; player++) {
+        if (config->agents[player].type == AgentType::MctsAgent) {
+            engines.mcts[player].reset(new MctsEngine(SELFPLAY_MCTS_NODES));
+        }
+    }
+
+    *stats = {};
+    GameRecord record;
+
+    while (true) {
+        uint64_t first = next->fetch_add(SELFPLAY_BATCH);
+        if (first >= config->games) {
+            break;
+        }
+
+        uint64_t last = std::min(first + SELFPLAY_BATCH, config->games);
+        for (uint64_t index = first; index < last; index++) {
+            unsigned int length;
+            Token winner =
+                playGame(*config, index, &engines, &length, &record);
+            if (config->records != nullptr) {
+                for (unsigned int player = 0; player < 2; player++) {
+                    setRecordPlayer((Token)player,
+                                    formatAgent(config->agents[player]),
+                                    SELFPLAY_SYMBOLS[player], &record);
+                }
+                config->records->write(record);
+            }
+            Token first_player =
+                index % 2 == 0 ? Token::Player1 : Token::Player2;
+
+            stats->games++;
+            stats->moves += length;
+            stats->longest = std::max<uint64_t>(stats->longest, length);
+
+            if (winner == Token::Empty) {
+                stats->draws++;
+            } else {
+                stats->wins[winner]++;
+                stats->first_player_wins += winner == first_player;
+            }
+        }
+    }
+}
+
+// Plays the configured amount of games on parallel threads. Every game gets
+// its own random seed derived from its index, so the results don't depend on
+// the amount of threads.
+SelfPlayStats runSelfPlay(const SelfPlayConfig &config) {
+    unsigned int threads = std::max(config.threads, 1u);
+    std::vector<SelfPlayStats> thread_stats(threads);
+    std::vector<std::thread> workers;
+    std::atomic<uint64_t> next(0);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned int i = 0; i < threads; i++) {
+        workers.emplace_back(selfPlayThread, &config, &next, &thread_stats[i]);
+    }
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    if (config.records != nullptr) {
+        config.records->flush();
+    }
+
+    SelfPlayStats stats = {};
+    for (const SelfPlayStats &part : thread_stats) {
+        stats.games += part.games;
+        stats.wins[Token::Player1] += part.wins[Token::Player1];
+        stats.wins[Token::Player2] += part.wins[Token::Player2];
+        stats.draws += part.draws;
+        stats.first_player_wins += part.first_player_wins;
+        stats.moves += part.moves;
+        stats.longest = std::max(stats.longest, part.longest);
+    }
+
+    stats.seconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+
+    return stats;
+}
+
+void printSelfPlayStats(const SelfPlayConfig &config,
+                        const SelfPlayStats &stats) {
+    std::cout << std::fixed << std::setprecision(2)
+              << "mode: " << (config.rotations ? "pentago" : "tictactoe")
+              << std::endl
+              << "games: " << stats.games << std::endl
+              << "player1 (" << formatAgent(config.agents[Token::Player1])
+              << ") wins: " << stats.wins[Token::Player1] << " ("
+              << percent(stats.wins[Token::Player1], stats.games) << "%)"
+              << std::endl
+              << "player2 (" << formatAgent(config.agents[Token::Player2])
+              << ") wins: " << stats.wins[Token::Player2] << " ("
+              << percent(stats.wins[Token::Player2], stats.games) << "%)"
+              << std::endl
+              << "draws: " << stats.draws << " ("
+              << percent(stats.draws, stats.games) << "%)" << std::endl
+              << "first player wins: " << stats.first_player_wins << " ("
+              << percent(stats.first_player_wins, stats.games) << "%)"
+              << std::endl
+              << "average length: "
+              << (stats.games ? (double)stats.moves / stats.games : 0)
+              << " moves" << std::endl
+              << "longest game: " << stats.longest << " moves" << std::endl
+              << "time: " << stats.seconds << " s" << std::endl
+              << "games/s: "
+              << (stats.seconds > 0 ? stats.games / stats.seconds : 0)
+              << std::endl;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "position.hpp"
+#include "record.hpp"
+
+enum AgentType {
+    RandomAgent = 0,
+    GreedyAgent = 1,
+    EngineAgent = 2,
+    MctsAgent = 3,
+};
+
+struct AgentConfig {
+    AgentType type;
+    unsigned int depth;     // Search depth of EngineAgent
+    uint64_t playouts = 0;  // Playouts per move of MctsAgent
+};
+
+struct SelfPlayConfig {
+    uint64_t games = 1000;
+    AgentConfig agents[2] = { { AgentType::RandomAgent, 0 },
+                              { AgentType::RandomAgent, 0 } };
+    bool rotations = true;
+    unsigned int threads = 1;
+    uint64_t seed = 1;
+    // Moves played at random at the start of each game, so that
+    // deterministic players don't repeat the same game
+    unsigned int random_plies = 2;
+    // Receives every finished game when set
+    GameRecordWriter *records = nullptr;
+};
+
+struct SelfPlayStats {
+    uint64_t games;
+    uint64_t wins[2];  // Indexed by Token
+    uint64_t draws;
+    uint64_t first_player_wins;
+    uint64_t moves;
+    uint64_t longest;
+    double seconds;
+};
+
+int parseAgent(const std::string &spec, AgentConfig *agent);
+std::string formatAgent(const AgentConfig &agent);
+SelfPlayStats runSelfPlay(const SelfPlayConfig &config);
+void printSelfPlayStats(const SelfPlayConfig &config,
+                        const SelfPlayStats &stats);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Publishes a value from a single writer to any amount of readers without
+// locks. Readers copy the value and retry when the writer changed it in the
+// meantime, which they notice by the sequence number being odd (a write in
+// progress) or different before and after the copy.
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value);
+
+   private:
+    static constexpr size_t WORDS = (sizeof(T) + 7) / 8;
+    std::atomic<uint32_t> sequence{ 0 };
+    std::atomic<uint64_t> words[WORDS] = {};
+
+   public:
+    // Only one thread at a time may store
+    void store(const T &value) {
+        uint64_t buffer[WORDS] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+
+        uint32_t sequence = this->sequence.load(std::memory_order_relaxed);
+        this->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < WORDS; i++) {
+            this->words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+
+        this->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        uint64_t buffer[WORDS];
+        uint32_t before, after;
+
+        do {
+            before = this->sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORDS; i++) {
+                buffer[i] = this->words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = this->sequence.load(std::memory_order_relaxed);
+        } while (before != after || (before & 1) != 0);
+
+        T value;
+        std::memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+};
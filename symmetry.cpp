@@ -0,0 +1,155 @@
+#include "symmetry.hpp"
+
+struct SymmetryTable {
+    uint8_t cells[SYMMETRY_COUNT][CELL_COUNT];
+    uint8_t rotations[SYMMETRY_COUNT][NO_ROTATION + 1];
+    unsigned int inverse[SYMMETRY_COUNT];
+    // Zobrist key of a quad row pattern after transforming it, indexed by
+    // [symmetry][player][quad][row][row pattern]
+    uint64_t keys[SYMMETRY_COUNT][2][4][QUAD_SIZE][1 << QUAD_SIZE];
+};
+
+constexpr SymmetryTable makeSymmetryTable() {
+    SymmetryTable table = {};
+
+    for (unsigned int s = 0; s < SYMMETRY_COUNT; s++) {
+        for (unsigned int cell = 0; cell < CELL_COUNT; cell++) {
+            table.cells[s][cell] = symmetryCell(s, cell);
+        }
+
+        // Mirroring the board reverses the direction of quad rotations
+        unsigned int mirrors = (s & 1) + ((s >> 1) & 1) + ((s >> 2) & 1);
+        for (unsigned int quad = 0; quad < QUAD_COUNT; quad++) {
+            unsigned int cell = symmetryCell(s, quadOrigin(quad));
+            unsigned int mapped =
+                quadIndex(cell / BOARD_SIZE, cell % BOARD_SIZE);
+
+            for (unsigned int rot = 0; rot < 2; rot++) {
+                table.rotations[s][rotationCode(quad, (Rotation)rot)] =
+                    rotationCode(mapped, (Rotation)(rot ^ (mirrors % 2)));
+            }
+        }
+        table.rotations[s][NO_ROTATION] = NO_ROTATION;
+
+        for (unsigned int t = 0; t < SYMMETRY_COUNT; t++) {
+            bool identity = true;
+            for (unsigned int cell = 0; cell < CELL_COUNT; cell++) {
+                identity &= symmetryCell(t, symmetryCell(s, cell)) == cell;
+            }
+            if (identity) {
+                table.inverse[s] = t;
+            }
+        }
+
+        for (unsigned int p = 0; p < 2; p++) {
+            for (unsigned int quad = 0; quad < QUAD_COUNT; quad++) {
+                for (unsigned int row = 0; row < QUAD_SIZE; row++) {
+                    for (unsigned int bits = 0; bits < (1 << QUAD_SIZE);
+                         bits++) {
+                        uint64_t key = 0;
+
+                        for (unsigned int col = 0; col < QUAD_SIZE; col++) {
+                            if (bits & (1 << col)) {
+                                unsigned int cell = quadOrigin(quad) +
+                                                    cellIndex(row, col);
+                                key ^= ZOBRIST.cells[p][symmetryCell(s, cell)];
+                            }
+                        }
+
+                        table.keys[s][p][quad][row][bits] = key;
+                    }
+                }
+            }
+        }
+    }
+
+    return table;
+}
+
+constexpr SymmetryTable SYMMETRY_TABLE = makeSymmetryTable();
+
+Move transformMove(Move move, unsigned int symmetry) {
+    return { SYMMETRY_TABLE.cells[symmetry][move.cell],
+             SYMMETRY_TABLE.rotations[symmetry][move.rotation] };
+}
+
+Position transformPosition(const Position &position, unsigned int symmetry) {
+    Position out;
+    out.clear();
+
+    for (unsigned int p = Token::Player1; p <= Token::Player2; p++) {
+        for (Bitboard tokens = position.tokens[p]; tokens;
+             tokens &= tokens - 1) {
+            unsigned int cell = __builtin_ctzll(tokens);
+            out.place(SYMMETRY_TABLE.cells[symmetry][cell], (Token)p);
+        }
+    }
+
+    return out;
+}
+
+unsigned int inverseSymmetry(unsigned int symmetry) {
+    return SYMMETRY_TABLE.inverse[symmetry];
+}
+
+// Zobrist key of the position transformed by a symmetry, computed without
+// transforming the position itself
+uint64_t symmetricKey(const Position &position, unsigned int symmetry) {
+    uint64_t key = 0;
+
+    for (unsigned int p = 0; p < 2; p++) {
+        for (unsigned int quad = 0; quad < QUAD_COUNT; quad++) {
+            for (unsigned int row = 0; row < QUAD_SIZE; row++) {
+                Bitboard bits =
+                    (position.tokens[p] >>
+                     (quadOrigin(quad) + row * BOARD_SIZE)) &
+                    QUAD_ROW_MASK;
+                key ^= SYMMETRY_TABLE.keys[symmetry][p][quad][row][bits];
+            }
+        }
+    }
+
+    return key;
+}
+
+// Smallest key among all symmetric variants of the position, which is the
+// same for every one of them. `symmetry` receives the symmetry mapping the
+// position onto the variant with that key.
+uint64_t canonicalKey(const Position &position, unsigned int *symmetry) {
+    uint64_t patterns[2][4][QUAD_SIZE];
+
+    for (unsigned int p = 0; p < 2; p++) {
+        for (unsigned int quad = 0; quad < QUAD_COUNT; quad++) {
+            for (unsigned int row = 0; row < QUAD_SIZE; row++) {
+                patterns[p][quad][row] =
+                    (position.tokens[p] >>
+                     (quadOrigin(quad) + row * BOARD_SIZE)) &
+                    QUAD_ROW_MASK;
+            }
+        }
+    }
+
+    // The identity is kept up to date by the position itself
+    uint64_t best = position.key;
+    *symmetry = 0;
+
+    for (unsigned int s = 1; s < SYMMETRY_COUNT; s++) {
+        const auto &keys = SYMMETRY_TABLE.keys[s];
+        uint64_t key = 0;
+
+        for (unsigned int p = 0; p < 2; p++) {
+            for (unsigned int quad = 0; quad < QUAD_COUNT; quad++) {
+                for (unsigned int row = 0; row < QUAD_SIZE; row++) {
+                    key ^= keys[p][quad][row][patterns[p][quad][row]];
+                }
+            }
+        }
+
+        if (key < best) {
+            best = key;
+            *symmetry = s;
+        }
+    }
+
+    return best;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "position.hpp"
+
+// The board looks the same after any of its 4 rotations, each optionally
+// mirrored. Quads map onto quads, so the rules don't change either.
+const unsigned int SYMMETRY_COUNT = 8;
+
+// Maps cell (y, x) by a symmetry, whose bits select in order: transposing,
+// flipping the rows and flipping the columns
+constexpr unsigned int symmetryCell(unsigned int symmetry, unsigned int cell) {
+    unsigned int y = cell / BOARD_SIZE, x = cell % BOARD_SIZE;
+
+    if (symmetry & 1) {
+        unsigned int t = y;
+        y = x;
+        x = t;
+    }
+    if (symmetry & 2) {
+        y = BOARD_SIZE - 1 - y;
+    }
+    if (symmetry & 4) {
+        x = BOARD_SIZE - 1 - x;
+    }
+
+    return cellIndex(y, x);
+}
+
+Move transformMove(Move move, unsigned int symmetry);
+Position transformPosition(const Position &position, unsigned int symmetry);
+unsigned int inverseSymmetry(unsigned int symmetry);
+uint64_t symmetricKey(const Position &position, unsigned int symmetry);
+uint64_t canonicalKey(const Position &position, unsigned int *symmetry);
@@ -0,0 +1,408 @@
+#include "tablebase.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "movegen.hpp"
+#include "rank.hpp"
+#include "symmetry.hpp"
+
+// Positions claimed at once by a thread
+const uint64_t TABLEBASE_CHUNK = 256;
+
+std::string tablebaseSlicePath(const std::string &directory,
+                               unsigned int tokens) {
+    std::string name = std::to_string(tokens);
+    if (name.length() < 2) {
+        name = "0" + name;
+    }
+    return directory + "/slice" + name + ".tb";
+}
+
+// Rank of the position's variant with the smallest key among its symmetric
+// ones, which is the same for every one of them
+uint64_t canonicalRank(const Position &position) {
+    unsigned int symmetry;
+    canonicalKey(position, &symmetry);
+
+    if (symmetry == 0) {
+        return rankPosition(position);
+    }
+    return rankPosition(transformPosition(position, symmetry));
+}
+
+// Value of a finished game for `player`, who is either to move in the
+// finished position or made the move which finished it. Completing only the
+// opponent's line loses.
+TablebaseValue finishedValue(unsigned int winners, Token player) {
+    if (winners == (WINNER_PLAYER1 | WINNER_PLAYER2)) {
+        return TablebaseDraw;
+    }
+    return winners & (1 << player) ? TablebaseWin : TablebaseLoss;
+}
+
+// Calls `work` with every index below `count` and the id of the thread
+// running it. Indices are claimed in chunks by the threads.
+void runParallel(uint64_t count, unsigned int threads,
+                 const std::function<void(uint64_t, unsigned int)> &work) {
+    std::atomic<uint64_t> next(0);
+
+    auto run = [&](unsigned int thread) {
+        for (uint64_t begin = next.fetch_add(TABLEBASE_CHUNK); begin < count;
+             begin = next.fetch_add(TABLEBASE_CHUNK)) {
+            uint64_t end = std::min(begin + TABLEBASE_CHUNK, count);
+            for (uint64_t i = begin; i < end; i++) {
+                work(i, thread);
+            }
+        }
+    };
+
+    std::vector<std::thread> helpers;
+    for (unsigned int i = 1; i < threads; i++) {
+        helpers.emplace_back(run, i);
+    }
+
+    run(0);
+
+    for (std::thread &helper : helpers) {
+        helper.join();
+    }
+}
+
+// Header of a mapped slice file, or nullptr if the file isn't a complete
+// slice
+const TablebaseHeader *sliceHeader(const MappedFile &file) {
+    if (file.size() < sizeof(TablebaseHeader)) {
+        return nullptr;
+    }
+
+    const TablebaseHeader *header = (const TablebaseHeader *)file.data();
+    if (std::memcmp(header->magic, TABLEBASE_MAGIC, sizeof(header->magic)) !=
+            0 ||
+        header->version != TABLEBASE_VERSION ||
+        header->tokens > CELL_COUNT || header->player > Token::Player2 ||
+        file.size() !=
+            sizeof(TablebaseHeader) + header->count * sizeof(uint64_t)) {
+        return nullptr;
+    }
+
+    return header;
+}
+
+bool writeSlice(const std::string &path, const TablebaseHeader &header,
+                const std::vector<uint64_t> &ranks,
+                const std::vector<uint8_t> &values) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write((const char *)&header, sizeof(header));
+
+    std::vector<uint64_t> records(ranks.size());
+    for (size_t i = 0; i < ranks.size(); i++) {
+        records[i] = ranks[i] << 2 | values[i];
+    }
+    out.write((const char *)records.data(),
+              records.size() * sizeof(uint64_t));
+
+    return (bool)out;
+}
+
+// Every position of a slice is expanded before the next slice is solved, so
+// the positions of all slices are kept in memory during the build. Slices
+// are solved from the fullest one, looking the children up in the slice
+// solved just before.
+bool buildTablebase(const Position &root, Token player, bool rotations,
+                    const std::string &directory, unsigned int threads) {
+    threads = std::max(threads, 1u);
+    auto start = std::chrono::steady_clock::now();
+    unsigned int root_tokens = __builtin_popcountll(root.occupied());
+
+    // Sorted canonical ranks of the positions of each slice, from the root
+    std::vector<std::vector<uint64_t>> slices;
+    slices.push_back({ canonicalRank(root) });
+
+    while (true) {
+        const std::vector<uint64_t> &slice = slices.back();
+        Token mover = slices.size() % 2 == 1 ? player : otherPlayer(player);
+        std::vector<std::vector<uint64_t>> children(threads);
+
+        runParallel(slice.size(), threads, [&](uint64_t i,
+                                                unsigned int thread) {
+            Position position;
+            unrankPosition(slice[i], &position);
+            if (winners(position) != 0 || position.full()) {
+                return;
+            }
+
+            MoveList list;
+            generateMoves(position, mover, rotations, &list);
+
+            for (unsigned int m = 0; m < list.count; m++) {
+                Position child = position;
+                child.makeMove(list.moves[m], mover);
+                children[thread].push_back(canonicalRank(child));
+            }
+        });
+
+        std::vector<uint64_t> next;
+        for (std::vector<uint64_t> &found : children) {
+            next.insert(next.end(), found.begin(), found.end());
+            std::vector<uint64_t>().swap(found);
+        }
+        std::sort(next.begin(), next.end());
+        next.erase(std::unique(next.begin(), next.end()), next.end());
+
+        if (next.empty()) {
+            break;
+        }
+        slices.push_back(std::move(next));
+    }
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "tokens    positions       wins      draws     losses"
+              << std::endl;
+
+    uint64_t total = 0;
+    std::vector<uint8_t> next_values;
+
+    for (size_t depth = slices.size(); depth-- > 0;) {
+        const std::vector<uint64_t> &slice = slices[depth];
+        const std::vector<uint64_t> *next =
+            depth + 1 < slices.size() ? &slices[depth + 1] : nullptr;
+        Token mover = depth % 2 == 0 ? player : otherPlayer(player);
+        std::vector<uint8_t> values(slice.size());
+
+        runParallel(slice.size(), threads, [&](uint64_t i, unsigned int) {
+            Position position;
+            unrankPosition(slice[i], &position);
+
+            unsigned int result = winners(position);
+            if (result != 0 || position.full()) {
+                values[i] = result != 0 ? finishedValue(result, mover)
+                                        : TablebaseDraw;
+                return;
+            }
+
+            MoveList list;
+            generateMoves(position, mover, rotations, &list);
+            uint8_t best = TablebaseLoss;
+
+            for (unsigned int m = 0; m < list.count && best != TablebaseWin;
+                 m++) {
+                Position child = position;
+                child.makeMove(list.moves[m], mover);
+
+                // Every child was found while expanding this slice
+                size_t index = std::lower_bound(next->begin(), next->end(),
+                                                canonicalRank(child)) -
+                               next->begin();
+                best = std::max(best, (uint8_t)(TablebaseWin -
+                                                 next_values[index]));
+            }
+
+            values[i] = best;
+        });
+
+        uint64_t counts[3] = { 0, 0, 0 };
+        for (uint8_t value : values) {
+            counts[value]++;
+        }
+
+        TablebaseHeader header = {};
+        std::memcpy(header.magic, TABLEBASE_MAGIC, sizeof(header.magic));
+        header.version = TABLEBASE_VERSION;
+        header.tokens = root_tokens + depth;
+        header.player = mover;
+        header.rotations = rotations;
+        header.count = slice.size();
+
+        std::string path = tablebaseSlicePath(directory, header.tokens);
+        if (!writeSlice(path, header, slice, values)) {
+            std::cout << "Can't write " << path << std::endl;
+            return false;
+        }
+
+        std::cout << std::setw(6) << (unsigned int)header.tokens
+                  << std::setw(13) << slice.size() << std::setw(11)
+                  << counts[TablebaseWin] << std::setw(11)
+                  << counts[TablebaseDraw] << std::setw(11)
+                  << counts[TablebaseLoss] << std::endl;
+
+        total += slice.size();
+        next_values = std::move(values);
+        if (next != nullptr) {
+            std::vector<uint64_t>().swap(slices[depth + 1]);
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    std::cout << std::endl
+              << "root: "
+              << (next_values[0] == TablebaseWin    ? "win"
+                  : next_values[0] == TablebaseDraw ? "draw"
+                                                    : "loss")
+              << std::endl
+              << "positions: " << total << std::endl
+              << "time: " << seconds << " s" << std::endl;
+
+    return true;
+}
+
+// Plain search for the value of the position, stopping at the first win
+TablebaseValue solvePosition(Position *position, Token player, bool rotations,
+                             uint64_t *nodes) {
+    MoveList list;
+    generateMoves(*position, player, rotations, &list);
+    TablebaseValue best = TablebaseLoss;
+
+    for (unsigned int i = 0; i < list.count && best != TablebaseWin; i++) {
+        Move move = list.moves[i];
+        position->makeMove(move, player);
+        (*nodes)++;
+
+        TablebaseValue value;
+        unsigned int result = winnersAfterMove(*position, move);
+        if (result != 0) {
+            value = finishedValue(result, player);
+        } else if (position->full()) {
+            value = TablebaseDraw;
+        } else {
+            value = (TablebaseValue)(TablebaseWin -
+                                     solvePosition(position,
+                                                   otherPlayer(player),
+                                                   rotations, nodes));
+        }
+
+        position->unmakeMove(move, player);
+        best = std::max(best, value);
+    }
+
+    return best;
+}
+
+bool verifyTablebaseSlice(const std::string &path, uint64_t samples,
+                          unsigned int threads) {
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cout << "Can't open " << path << std::endl;
+        return false;
+    }
+
+    const TablebaseHeader *header = sliceHeader(file);
+    if (header == nullptr) {
+        std::cout << path << " isn't a tablebase slice" << std::endl;
+        return false;
+    }
+
+    const uint64_t *records = (const uint64_t *)(header + 1);
+    Token player = (Token)header->player;
+    uint64_t checked =
+        samples == 0 ? header->count : std::min(samples, header->count);
+
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<uint64_t> nodes(0);
+    std::mutex mismatches_lock;
+    std::vector<uint64_t> mismatches;
+
+    runParallel(checked, std::max(threads, 1u), [&](uint64_t i,
+                                                     unsigned int) {
+        uint64_t record = records[i * header->count / checked];
+        Position position;
+        unrankPosition(record >> 2, &position);
+
+        TablebaseValue value;
+        uint64_t solved_nodes = 0;
+        unsigned int result = winners(position);
+        if (result != 0) {
+            value = finishedValue(result, player);
+        } else if (position.full()) {
+            value = TablebaseDraw;
+        } else {
+            value = solvePosition(&position, player, header->rotations,
+                                  &solved_nodes);
+        }
+
+        nodes += solved_nodes;
+        if (value != (TablebaseValue)(record & 3)) {
+            std::lock_guard<std::mutex> lock(mismatches_lock);
+            mismatches.push_back(record);
+        }
+    });
+
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    std::sort(mismatches.begin(), mismatches.end());
+    for (uint64_t record : mismatches) {
+        std::cout << "mismatch: rank " << (record >> 2) << " stored "
+                  << (record & 3) << std::endl;
+    }
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "tokens: " << (unsigned int)header->tokens << std::endl
+              << "records: " << header->count << std::endl
+              << "checked: " << checked << std::endl
+              << "mismatches: " << mismatches.size() << std::endl
+              << "nodes: " << nodes << std::endl
+              << "time: " << seconds << " s" << std::endl;
+
+    return mismatches.empty();
+}
+
+unsigned int Tablebase::open(const std::string &directory) {
+    unsigned int count = 0;
+
+    for (unsigned int tokens = 0; tokens <= CELL_COUNT; tokens++) {
+        Slice &slice = this->slices[tokens];
+        slice.header = nullptr;
+        slice.records = nullptr;
+
+        if (!slice.file.open(tablebaseSlicePath(directory, tokens))) {
+            continue;
+        }
+
+        const TablebaseHeader *header = sliceHeader(slice.file);
+        if (header == nullptr || header->tokens != tokens) {
+            slice.file.close();
+            continue;
+        }
+
+        slice.header = header;
+        slice.records = (const uint64_t *)(header + 1);
+        count++;
+    }
+
+    return count;
+}
+
+bool Tablebase::probe(const Position &position, Token player, bool rotations,
+                      TablebaseValue *value) const {
+    const Slice &slice =
+        this->slices[__builtin_popcountll(position.occupied())];
+
+    if (slice.header == nullptr || slice.header->player != player ||
+        (bool)slice.header->rotations != rotations) {
+        return false;
+    }
+
+    uint64_t rank = canonicalRank(position);
+    const uint64_t *end = slice.records + slice.header->count;
+    const uint64_t *found = std::lower_bound(slice.records, end, rank << 2);
+
+    if (found == end || (*found >> 2) != rank) {
+        return false;
+    }
+
+    *value = (TablebaseValue)(*found & 3);
+    return true;
+}
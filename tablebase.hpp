@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "mapped_file.hpp"
+#include "position.hpp"
+
+// Game-theoretic results of endgame positions, solved backward from the
+// finished games.
+//
+// A tablebase covers every position reachable from one root position, which
+// bounds the positions by the root's empty cells. It is stored as one slice
+// file per amount of tokens on the board. A slice holds a sorted array of
+// records, each being the rank of a position's symmetry-canonical variant
+// (see rank.hpp) shifted up by 2 bits, with its TablebaseValue below. Slices
+// are probed through memory mappings by binary search, so only the pages
+// touched by the search are ever read.
+
+// Result with perfect play for the player to move
+enum TablebaseValue {
+    TablebaseLoss = 0,
+    TablebaseDraw = 1,
+    TablebaseWin = 2,
+};
+
+const char TABLEBASE_MAGIC[8] = { 'P', 'T', 'G', 'O', 'T', 'B', '\0', '\0' };
+const uint32_t TABLEBASE_VERSION = 1;
+
+struct TablebaseHeader {
+    char magic[8];
+    uint32_t version;
+    uint8_t tokens;     // Tokens on the board in every position of the slice
+    uint8_t player;     // Player to move in every position of the slice
+    uint8_t rotations;  // Whether moves rotate quads
+    uint8_t reserved;
+    uint64_t count;     // Records following the header
+};
+
+static_assert(sizeof(TablebaseHeader) == 24);
+
+// Path of the slice file with the given amount of tokens
+std::string tablebaseSlicePath(const std::string &directory,
+                               unsigned int tokens);
+
+// Solves every position reachable from the root, one slice at a time, and
+// writes the slices into the existing directory. Positions of each slice
+// are split between the threads. Prints the progress of every slice and
+// returns false if a slice couldn't be written.
+bool buildTablebase(const Position &root, Token player, bool rotations,
+                    const std::string &directory, unsigned int threads);
+
+// Solves positions from the slice file by plain search, without the
+// tablebase, and compares the results. Checks `samples` evenly spread
+// records, or all of them when 0. Prints the mismatches and a summary and
+// returns false if any result differs.
+bool verifyTablebaseSlice(const std::string &path, uint64_t samples,
+                          unsigned int threads);
+
+class Tablebase {
+   private:
+    struct Slice {
+        MappedFile file;
+        const TablebaseHeader *header = nullptr;
+        const uint64_t *records = nullptr;
+    };
+
+    Slice slices[CELL_COUNT + 1];
+
+   public:
+    // Maps every valid slice file found in the directory, returning their
+    // amount
+    unsigned int open(const std::string &directory);
+    // Looks the position up, returning false when no slice contains it
+    bool probe(const Position &position, Token player, bool rotations,
+               TablebaseValue *value) const;
+};
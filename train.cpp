@@ -0,0 +1,454 @@
+// Trains the evaluation network (see nnue.hpp) from recorded games and
+// writes its quantized weights.
+//
+// Every position before a move of a finished game is a sample, labelled
+// with a mix of the game's result for the player to move and the static
+// evaluation's win probability, weighted by --lambda. The network is
+// trained in floating point with Adam on shuffled mini-batches, keeping the
+// weights within the quantized ranges, and then rounded to integers.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "eval.hpp"
+#include "nnue.hpp"
+#include "rank.hpp"
+#include "record.hpp"
+#include "util.hpp"
+
+const unsigned int TRAIN_DEFAULT_EPOCHS = 10;
+const unsigned int TRAIN_DEFAULT_BATCH = 256;
+const float TRAIN_DEFAULT_RATE = 0.001f;
+const float TRAIN_DEFAULT_LAMBDA = 0.5f;
+const uint64_t TRAIN_DEFAULT_MAX_POSITIONS = 4000000;
+// Samples used to compare the quantized network with the trained one
+const unsigned int TRAIN_CHECK_SAMPLES = 10000;
+// Limits keeping the quantized weights and accumulators in range
+const float FEATURE_WEIGHT_LIMIT = 4.0f;
+const float HIDDEN_WEIGHT_LIMIT = 127.0f / NNUE_WEIGHT_SCALE;
+
+struct Sample {
+    Bitboard own;    // Tokens of the player to move
+    Bitboard other;
+    float target;    // Expected result for the player to move, 0 to 1
+};
+
+// Same layout as NnueWeights, in floating point and without the scales
+struct FloatNetwork {
+    float feature_weights[NNUE_FEATURES][NNUE_HIDDEN];
+    float feature_biases[NNUE_HIDDEN];
+    float hidden_weights[NNUE_HIDDEN2][2 * NNUE_HIDDEN];
+    float hidden_biases[NNUE_HIDDEN2];
+    float output_weights[NNUE_HIDDEN2];
+    float output_bias;
+};
+
+// Adam treats the network as one array of parameters
+const unsigned int PARAMETERS = sizeof(FloatNetwork) / sizeof(float);
+static_assert(sizeof(FloatNetwork) == PARAMETERS * sizeof(float));
+
+float sigmoid(float x) {
+    return 1 / (1 + std::exp(-x));
+}
+
+// Reads the samples of every finished game, up to `max_samples`
+bool loadSamples(const std::string &path, float lambda, uint64_t max_samples,
+                 std::vector<Sample> *samples) {
+    GameRecordReader reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+
+    GameView game;
+    while (samples->size() < max_samples && reader.next(&game)) {
+        if (game.header.result == GameRecordResult::RecordUnfinished) {
+            continue;
+        }
+
+        // Skips games which don't replay up to their end
+        Position position;
+        unsigned int played = replayGame(game, &position);
+        if (played < game.header.moves || played == 0) {
+            continue;
+        }
+
+        unrankPosition(game.header.start, &position);
+        Token player = (Token)game.header.first;
+        const uint8_t *bytes = game.moves;
+
+        for (unsigned int i = 0; i < played; i++) {
+            float result = game.header.result == GameRecordResult::RecordDraw
+                               ? 0.5f
+                               : game.header.result == (unsigned int)player;
+            float eval = sigmoid((float)evaluate(position, player) /
+                                 NNUE_SCORE_SCALE);
+            samples->push_back({ position.tokens[player],
+                                 position.tokens[otherPlayer(player)],
+                                 lambda * result + (1 - lambda) * eval });
+
+            Move move;
+            bytes += unpackMove(bytes, &move);
+            position.makeMove(move, player);
+            player = otherPlayer(player);
+        }
+    }
+
+    return true;
+}
+
+// Layer outputs of a sample, before and after clipping
+struct Activations {
+    float hidden1[2 * NNUE_HIDDEN];  // Side to move's point of view first
+    float inputs[2 * NNUE_HIDDEN];
+    float hidden2[NNUE_HIDDEN2];
+    float outputs2[NNUE_HIDDEN2];
+    float output;
+};
+
+// Tokens of each point of view: own, then the opponent's
+void sampleViews(const Sample &sample, Bitboard views[2][2]) {
+    views[0][0] = views[1][1] = sample.own;
+    views[0][1] = views[1][0] = sample.other;
+}
+
+void forward(const FloatNetwork &net, const Sample &sample,
+             Activations *out) {
+    Bitboard views[2][2];
+    sampleViews(sample, views);
+
+    for (unsigned int half = 0; half < 2; half++) {
+        float *acc = out->hidden1 + half * NNUE_HIDDEN;
+        std::memcpy(acc, net.feature_biases, sizeof(net.feature_biases));
+
+        for (unsigned int side = 0; side < 2; side++) {
+            for (Bitboard cells = views[half][side]; cells != 0;
+                 cells &= cells - 1) {
+                const float *row =
+                    net.feature_weights[lowestBit(cells) + side * CELL_COUNT];
+                for (unsigned int i = 0; i < NNUE_HIDDEN; i++) {
+                    acc[i] += row[i];
+                }
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < 2 * NNUE_HIDDEN; i++) {
+        out->inputs[i] = std::clamp(out->hidden1[i], 0.0f, 1.0f);
+    }
+
+    out->output = net.output_bias;
+    for (unsigned int o = 0; o < NNUE_HIDDEN2; o++) {
+        out->hidden2[o] = net.hidden_biases[o];
+        for (unsigned int i = 0; i < 2 * NNUE_HIDDEN; i++) {
+            out->hidden2[o] += net.hidden_weights[o][i] * out->inputs[i];
+        }
+        out->outputs2[o] = std::clamp(out->hidden2[o], 0.0f, 1.0f);
+        out->output += net.output_weights[o] * out->outputs2[o];
+    }
+}
+
+// Forward and backward pass of one sample, adding the gradients of the
+// squared error to `gradients`. Returns the error.
+float trainSample(const FloatNetwork &net, const Sample &sample,
+                  FloatNetwork *gradients) {
+    Activations act;
+    forward(net, sample, &act);
+    Bitboard views[2][2];
+    sampleViews(sample, views);
+
+    float predicted = sigmoid(act.output);
+    float error = predicted - sample.target;
+
+    // Backward, clipped activations pass gradients only inside their range
+    float d_output = 2 * error * predicted * (1 - predicted);
+    gradients->output_bias += d_output;
+
+    float d_inputs[2 * NNUE_HIDDEN] = {};
+    for (unsigned int o = 0; o < NNUE_HIDDEN2; o++) {
+        gradients->output_weights[o] += d_output * act.outputs2[o];
+        if (act.hidden2[o] <= 0 || act.hidden2[o] >= 1) {
+            continue;
+        }
+
+        float d_hidden = d_output * net.output_weights[o];
+        gradients->hidden_biases[o] += d_hidden;
+        for (unsigned int i = 0; i < 2 * NNUE_HIDDEN; i++) {
+            gradients->hidden_weights[o][i] += d_hidden * act.inputs[i];
+            d_inputs[i] += d_hidden * net.hidden_weights[o][i];
+        }
+    }
+
+    for (unsigned int half = 0; half < 2; half++) {
+        float d_acc[NNUE_HIDDEN];
+        for (unsigned int i = 0; i < NNUE_HIDDEN; i++) {
+            float value = act.hidden1[half * NNUE_HIDDEN + i];
+            d_acc[i] = value > 0 && value < 1 ? d_inputs[half * NNUE_HIDDEN + i]
+                                              : 0;
+            gradients->feature_biases[i] += d_acc[i];
+        }
+
+        for (unsigned int side = 0; side < 2; side++) {
+            for (Bitboard cells = views[half][side]; cells != 0;
+                 cells &= cells - 1) {
+                float *row = gradients->feature_weights[lowestBit(cells) +
+                                                        side * CELL_COUNT];
+                for (unsigned int i = 0; i < NNUE_HIDDEN; i++) {
+                    row[i] += d_acc[i];
+                }
+            }
+        }
+    }
+
+    return error * error;
+}
+
+// Adam optimizer state
+struct Adam {
+    std::vector<float> mean = std::vector<float>(PARAMETERS);
+    std::vector<float> variance = std::vector<float>(PARAMETERS);
+    uint64_t steps = 0;
+
+    void step(const FloatNetwork &gradients, float rate, float scale,
+              FloatNetwork *net) {
+        const float beta1 = 0.9f, beta2 = 0.999f, epsilon = 1e-8f;
+        const float *grad = (const float *)&gradients;
+        float *params = (float *)net;
+
+        this->steps++;
+        float correction1 = 1 - std::pow(beta1, (float)this->steps);
+        float correction2 = 1 - std::pow(beta2, (float)this->steps);
+
+        for (unsigned int i = 0; i < PARAMETERS; i++) {
+            float g = grad[i] * scale;
+            this->mean[i] = beta1 * this->mean[i] + (1 - beta1) * g;
+            this->variance[i] =
+                beta2 * this->variance[i] + (1 - beta2) * g * g;
+            params[i] -= rate * (this->mean[i] / correction1) /
+                         (std::sqrt(this->variance[i] / correction2) +
+                          epsilon);
+        }
+    }
+};
+
+// Keeps the weights within the ranges of the quantized network
+void clampWeights(FloatNetwork *net) {
+    for (auto &row : net->feature_weights) {
+        for (float &weight : row) {
+            weight = std::clamp(weight, -FEATURE_WEIGHT_LIMIT,
+                                FEATURE_WEIGHT_LIMIT);
+        }
+    }
+    for (float &bias : net->feature_biases) {
+        bias = std::clamp(bias, -FEATURE_WEIGHT_LIMIT, FEATURE_WEIGHT_LIMIT);
+    }
+    for (auto &row : net->hidden_weights) {
+        for (float &weight : row) {
+            weight = std::clamp(weight, -HIDDEN_WEIGHT_LIMIT,
+                                HIDDEN_WEIGHT_LIMIT);
+        }
+    }
+    for (float &weight : net->output_weights) {
+        weight = std::clamp(weight, -HIDDEN_WEIGHT_LIMIT, HIDDEN_WEIGHT_LIMIT);
+    }
+}
+
+void initNetwork(FloatNetwork *net, Rng *rng) {
+    // Uniform in [-limit, limit] by the amount of inputs of each layer
+    auto uniform = [&](float limit) {
+        return (float)((rng->next() >> 11) * 0x1.0p-53 * 2 - 1) * limit;
+    };
+
+    std::memset(net, 0, sizeof(*net));
+    for (auto &row : net->feature_weights) {
+        for (float &weight : row) {
+            weight = uniform(1 / std::sqrt((float)CELL_COUNT));
+        }
+    }
+    for (float &bias : net->feature_biases) {
+        bias = 0.5f;
+    }
+    for (auto &row : net->hidden_weights) {
+        for (float &weight : row) {
+            weight = uniform(1 / std::sqrt((float)(2 * NNUE_HIDDEN)));
+        }
+    }
+    for (float &bias : net->hidden_biases) {
+        bias = 0.5f;
+    }
+    for (float &weight : net->output_weights) {
+        weight = uniform(1 / std::sqrt((float)NNUE_HIDDEN2));
+    }
+}
+
+template <class T>
+T quantize(float value, float scale, float limit) {
+    return (T)std::lround(std::clamp(value * scale, -limit, limit));
+}
+
+void quantizeNetwork(const FloatNetwork &net, NnueWeights *weights) {
+    const float activation = NNUE_ACTIVATION_MAX;
+    const float hidden = NNUE_WEIGHT_SCALE;
+
+    for (unsigned int f = 0; f < NNUE_FEATURES; f++) {
+        for (unsigned int i = 0; i < NNUE_HIDDEN; i++) {
+            weights->feature_weights[f][i] = quantize<int16_t>(
+                net.feature_weights[f][i], activation, INT16_MAX);
+        }
+    }
+    for (unsigned int i = 0; i < NNUE_HIDDEN; i++) {
+        weights->feature_biases[i] =
+            quantize<int16_t>(net.feature_biases[i], activation, INT16_MAX);
+    }
+
+    for (unsigned int o = 0; o < NNUE_HIDDEN2; o++) {
+        for (unsigned int i = 0; i < 2 * NNUE_HIDDEN; i++) {
+            weights->hidden_weights[o][i] =
+                quantize<int8_t>(net.hidden_weights[o][i], hidden, 127);
+        }
+        weights->hidden_biases[o] = quantize<int32_t>(
+            net.hidden_biases[o], activation * hidden, INT32_MAX);
+        weights->output_weights[o] =
+            quantize<int8_t>(net.output_weights[o], hidden, 127);
+    }
+    weights->output_bias =
+        quantize<int32_t>(net.output_bias, activation * hidden, INT32_MAX);
+}
+
+// Output of the trained network for a sample, in evaluation units
+float floatScore(const FloatNetwork &net, const Sample &sample) {
+    Activations act;
+    forward(net, sample, &act);
+    return act.output * NNUE_SCORE_SCALE;
+}
+
+int main(int argc, char *argv[]) {
+    std::string records_path, output_path;
+    unsigned int epochs = TRAIN_DEFAULT_EPOCHS;
+    unsigned int batch = TRAIN_DEFAULT_BATCH;
+    float rate = TRAIN_DEFAULT_RATE;
+    float lambda = TRAIN_DEFAULT_LAMBDA;
+    uint64_t max_positions = TRAIN_DEFAULT_MAX_POSITIONS;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if (std::strcmp(argv[i], "--epochs") == 0 && has_value) {
+            epochs = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--batch") == 0 && has_value &&
+                   std::atoi(argv[i + 1]) > 0) {
+            batch = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--rate") == 0 && has_value) {
+            rate = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--lambda") == 0 && has_value) {
+            lambda = std::clamp((float)std::atof(argv[++i]), 0.0f, 1.0f);
+        } else if (std::strcmp(argv[i], "--max-positions") == 0 &&
+                   has_value) {
+            max_positions = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && has_value) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (argv[i][0] != '-' && records_path.empty()) {
+            records_path = argv[i];
+        } else if (argv[i][0] != '-' && output_path.empty()) {
+            output_path = argv[i];
+        } else {
+            records_path.clear();
+            break;
+        }
+    }
+
+    if (records_path.empty() || output_path.empty()) {
+        std::cerr << "Usage: " << argv[0] << " RECORDS OUTPUT [options]"
+                  << std::endl
+                  << "\t--epochs N           passes over the samples, "
+                     "default 10"
+                  << std::endl
+                  << "\t--batch N            samples per weight update"
+                  << std::endl
+                  << "\t--rate X             Adam learning rate" << std::endl
+                  << "\t--lambda X           weight of the game results "
+                     "against the static evaluation, 0 to 1"
+                  << std::endl
+                  << "\t--max-positions N    samples read from the records"
+                  << std::endl
+                  << "\t--seed N             initial weights and shuffling"
+                  << std::endl;
+        return 1;
+    }
+
+    std::vector<Sample> samples;
+    if (!loadSamples(records_path, lambda, max_positions, &samples) ||
+        samples.empty()) {
+        std::cout << "No finished games in " << records_path << std::endl;
+        return 1;
+    }
+    std::cout << "samples: " << samples.size() << std::endl;
+
+    Rng rng(seed);
+    FloatNetwork net, gradients;
+    initNetwork(&net, &rng);
+    Adam adam;
+
+    for (unsigned int epoch = 0; epoch < epochs; epoch++) {
+        auto start = std::chrono::steady_clock::now();
+
+        // Fisher-Yates shuffle
+        for (size_t i = samples.size() - 1; i > 0; i--) {
+            std::swap(samples[i], samples[rng.next() % (i + 1)]);
+        }
+
+        double loss = 0;
+        for (size_t first = 0; first < samples.size(); first += batch) {
+            size_t last = std::min(first + batch, samples.size());
+            std::memset(&gradients, 0, sizeof(gradients));
+
+            for (size_t i = first; i < last; i++) {
+                loss += trainSample(net, samples[i], &gradients);
+            }
+
+            adam.step(gradients, rate, 1.0f / (last - first), &net);
+            clampWeights(&net);
+        }
+
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+        std::cout << std::fixed << std::setprecision(6) << "epoch " << epoch + 1
+                  << ": loss " << loss / samples.size() << std::setprecision(2)
+                  << ", " << seconds << " s" << std::endl;
+    }
+
+    NnueWeights weights;
+    quantizeNetwork(net, &weights);
+    if (!saveNetwork(output_path, weights)) {
+        std::cout << "Can't write " << output_path << std::endl;
+        return 1;
+    }
+
+    // The quantized network as loaded by the engine against the trained one
+    Network network;
+    network.load(output_path);
+    double difference = 0;
+    unsigned int checked =
+        std::min<size_t>(TRAIN_CHECK_SAMPLES, samples.size());
+    for (unsigned int i = 0; i < checked; i++) {
+        Position position;
+        position.clear();
+        position.tokens[Token::Player1] = samples[i].own;
+        position.tokens[Token::Player2] = samples[i].other;
+        difference += std::abs(network.evaluate(position, Token::Player1) -
+                               floatScore(net, samples[i]));
+    }
+
+    std::cout << "quantization error: " << difference / checked
+              << " average score difference" << std::endl
+              << "weights written to " << output_path << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "tt.hpp"
+
+#include <cstring>
+
+uint64_t packEntry(const TTEntry &entry) {
+    uint64_t data;
+    std::memcpy(&data, &entry, sizeof(data));
+    return data;
+}
+
+TTEntry unpackEntry(uint64_t data) {
+    TTEntry entry;
+    std::memcpy(&entry, &data, sizeof(entry));
+    return entry;
+}
+
+TranspositionTable::TranspositionTable(unsigned int size_mb) {
+    this->resize(size_mb);
+}
+
+// Allocates the largest power of two amount of slots fitting in `size_mb`
+void TranspositionTable::resize(unsigned int size_mb) {
+    uint64_t count = 1;
+    while (count * 2 * sizeof(Slot) <= (uint64_t)size_mb << 20) {
+        count *= 2;
+    }
+
+    this->slots.reset(new Slot[count]);
+    this->mask = count - 1;
+    this->clear();
+}
+
+void TranspositionTable::clear() {
+    for (uint64_t i = 0; i <= this->mask; i++) {
+        this->slots[i].check.store(0, std::memory_order_relaxed);
+        this->slots[i].data.store(0, std::memory_order_relaxed);
+    }
+
+    this->generation = 1;
+    this->used = 0;
+}
+
+// Marks entries stored so far as old, so they get replaced first. The
+// generation is never 0, which marks empty slots.
+void TranspositionTable::newSearch() {
+    this->generation = this->generation % 63 + 1;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry *entry,
+                               TTStats *stats) const {
+    const Slot &slot = this->slots[key & this->mask];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    stats->probes++;
+
+    if (data == 0) {
+        return false;
+    }
+
+    if ((check ^ data) != key) {
+        stats->collisions++;
+        return false;
+    }
+
+    stats->hits++;
+    *entry = unpackEntry(data);
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, int score, unsigned int depth,
+                               Bound bound, Move move, TTStats *stats) {
+    Slot &slot = this->slots[key & this->mask];
+    uint64_t old_data = slot.data.load(std::memory_order_relaxed);
+    uint64_t old_check = slot.check.load(std::memory_order_relaxed);
+
+    if (old_data == 0) {
+        this->used.fetch_add(1, std::memory_order_relaxed);
+    } else if ((old_check ^ old_data) != key) {
+        TTEntry old = unpackEntry(old_data);
+        if ((old.flags >> 2) == this->generation && old.depth > depth) {
+            return;
+        }
+    }
+
+    TTEntry entry = { score, move, (uint8_t)depth,
+                      (uint8_t)(bound | (this->generation << 2)) };
+    uint64_t data = packEntry(entry);
+
+    stats->stores++;
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+TTStats TranspositionTable::getStats() const {
+    TTStats stats = {};
+    stats.used = this->used.load(std::memory_order_relaxed);
+    stats.size = this->mask + 1;
+    return stats;
+}
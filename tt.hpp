@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "position.hpp"
+
+// Default size of the transposition table in megabytes
+const unsigned int TT_DEFAULT_SIZE_MB = 16;
+
+enum Bound {
+    Exact = 0,
+    LowerBound = 1,
+    UpperBound = 2,
+};
+
+struct TTEntry {
+    int32_t score;
+    Move move;
+    uint8_t depth;
+    uint8_t flags;  // Bound in the lowest 2 bits, search generation above,
+                    // 0 for empty slots
+
+    Bound bound() const { return (Bound)(this->flags & 3); }
+};
+
+static_assert(sizeof(TTEntry) == sizeof(uint64_t));
+
+struct TTStats {
+    uint64_t probes;
+    uint64_t hits;
+    uint64_t collisions;  // Probes finding a slot used by another position
+    uint64_t stores;
+    uint64_t used;        // Slots filled since the last clear
+    uint64_t size;
+};
+
+// Fixed-size hash table of search results, one entry per slot, shared by all
+// search threads without locking. Each slot holds the entry and the key
+// XORed with it, so a slot torn by two threads writing at once no longer
+// matches its key and reads as a miss. Entries from older searches and
+// shallower entries are replaced first.
+//
+// Counters are kept by the callers in their own TTStats, so that threads
+// don't share them.
+class TranspositionTable {
+   private:
+    struct Slot {
+        std::atomic<uint64_t> check;  // Key ^ data
+        std::atomic<uint64_t> data;   // TTEntry
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask;
+    uint8_t generation;
+    std::atomic<uint64_t> used;
+
+   public:
+    TranspositionTable(unsigned int size_mb);
+    void resize(unsigned int size_mb);
+    void clear();
+    void newSearch();
+    bool probe(uint64_t key, TTEntry *entry, TTStats *stats) const;
+    void store(uint64_t key, int score, unsigned int depth, Bound bound,
+               Move move, TTStats *stats);
+    TTStats getStats() const;
+};
@@ -2,4 +2,12 @@
 
 #include <iostream>
 
+#include "position.hpp"
+
 void clearScreen() { std::cout << "\033[2J\033[1;1H"; }
+
+double percent(uint64_t part, uint64_t total) {
+    return total == 0 ? 0.0 : 100.0 * part / total;
+}
+
+uint64_t Rng::next() { return splitMix64(&this->state); }
@@ -1 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
 void clearScreen();
+// Share of `part` in `total` in percent, 0 when `total` is 0
+double percent(uint64_t part, uint64_t total);
+
+// Small and fast pseudo-random generator (splitmix64), meant to be owned by a
+// single thread
+class Rng {
+   private:
+    uint64_t state;
+
+   public:
+    Rng(uint64_t seed) : state(seed) {}
+    uint64_t next();
+    // Uniform value in [0, n)
+    unsigned int below(unsigned int n) {
+        return ((this->next() >> 32) * n) >> 32;
+    }
+};